@@ -0,0 +1,152 @@
+﻿#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "../Models/Position.h"
+#include "MappedFile.h"
+#include "MoveGen.h"
+
+/**
+ * Дебютная книга: позиция → ходы с весами
+ * Строится программой Tools/bookgen.cpp по партиям ИИ с самим собой
+ * Записи отсортированы по ключу позиции, поиск — двоичный прямо по отображённому в память файлу
+ * Ход хранится как ключ позиции после него, так однозначно задаётся и вся серия взятий
+ */
+
+struct book_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t count;  // Число записей после заголовка
+};
+
+struct book_entry
+{
+  uint64_t key;      // Позиция до хода
+  uint64_t next;     // Позиция после хода
+  uint32_t weight;   // Сколько раз ход был сыгран
+  uint32_t reserved;
+};
+
+const char BOOK_MAGIC[8] = { 'C', 'H', 'K', 'R', 'B', 'K', '0', '1' };
+const uint32_t BOOK_VERSION = 1;
+
+// Ключ позиции в книге: расстановка и очередь хода
+inline uint64_t book_key(const Position& pos, const bool color)
+{
+  return pos.hash ^ (color ? ZOBRIST.side : 0);
+}
+
+/**
+ * Находит полный ход стороны color, после которого ключ позиции равен next
+ * В series добавляются шаги хода (для серии взятий — все взятия по порядку)
+ */
+inline bool find_turn_to(Position& pos, const bool color, const uint64_t next, std::vector<sq_move>& series,
+  const SQ_T s = NO_SQ)
+{
+  move_list list;
+  if (s == NO_SQ)
+    gen_moves(pos, color, list);
+  else
+    gen_beats_from(pos, s, list);
+  if (s != NO_SQ && list.empty())
+    return book_key(pos, !color) == next;
+  for (const auto& turn : list)
+  {
+    undo_info undo;
+    pos.make(turn, undo);
+    series.push_back(turn);
+    const bool found = (turn.beat != NO_SQ) ? find_turn_to(pos, color, next, series, turn.to)
+      : book_key(pos, !color) == next;
+    pos.unmake(turn, undo);
+    if (found)
+      return true;
+    series.pop_back();
+  }
+  return false;
+}
+
+class OpeningBook
+{
+public:
+  // Открывает файл книги, при ошибке возвращает false и книга не используется
+  bool open(const std::string& path)
+  {
+    if (!file.open(path))
+      return false;
+    const book_header* header = reinterpret_cast<const book_header*>(file.data());
+    if (file.size() < sizeof(book_header) || std::memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 ||
+      header->version != BOOK_VERSION || file.size() < sizeof(book_header) + size_t(header->count) * sizeof(book_entry))
+    {
+      file.close();
+      return false;
+    }
+    return true;
+  }
+
+  void close()
+  {
+    file.close();
+  }
+
+  bool is_open() const
+  {
+    return file.is_open();
+  }
+
+  /**
+   * Выбирает ход из книги для стороны color
+   * С генератором случайных чисел ход выбирается пропорционально весу, без него — самый частый
+   * Возвращает пустой вектор, если позиции нет в книге
+   */
+  std::vector<move_pos> choose(const Position& pos, const bool color, std::default_random_engine* rand_eng) const
+  {
+    std::vector<move_pos> res;
+    if (!is_open())
+      return res;
+    const book_entry* begin = entries();
+    const book_entry* end = begin + reinterpret_cast<const book_header*>(file.data())->count;
+    const uint64_t key = book_key(pos, color);
+    const book_entry* first = std::lower_bound(begin, end, key,
+      [](const book_entry& e, const uint64_t k) { return e.key < k; });
+    const book_entry* last = first;
+    uint64_t total = 0;
+    for (; last != end && last->key == key; ++last)
+      total += last->weight;
+    if (first == last || total == 0)
+      return res;
+
+    // Записи одной позиции отсортированы по убыванию веса
+    const book_entry* pick = first;
+    if (rand_eng)
+    {
+      uint64_t r = std::uniform_int_distribution<uint64_t>(0, total - 1)(*rand_eng);
+      while (r >= pick->weight)
+      {
+        r -= pick->weight;
+        ++pick;
+      }
+    }
+
+    Position p = pos;
+    std::vector<sq_move> series;
+    if (!find_turn_to(p, color, pick->next, series))
+      return res;
+    for (const auto& turn : series)
+      res.push_back(turn.to_move_pos());
+    return res;
+  }
+
+private:
+  const book_entry* entries() const
+  {
+    return reinterpret_cast<const book_entry*>(file.data() + sizeof(book_header));
+  }
+
+  MappedFile file;
+};
@@ -0,0 +1,80 @@
+﻿#pragma once
+#include <stdint.h>
+#include <utility>
+
+#include "../Models/Position.h"
+
+const int INF = 1e9;
+
+/**
+ * Оценочные функции — классы-стратегии для шаблона Search
+ * Режим выбирается один раз при создании Logic, и весь поиск компилируется под него,
+ * поэтому оценка листа встраивается в поиск без сравнения строк и виртуальных вызовов
+ * Оценка — отношение материала бота к материалу соперника (больше — лучше для бота, поиск её максимизирует
+ * в узлах хода бота), INF — у соперника не осталось фигур, 0 — у бота
+ * Новая оценка — ещё один класс с такой же статической функцией score и веткой в make_search (Search.h);
+ * для оценки блоками (EvalBatch.h) у неё должны быть и линейные веса, как у LinearEval
+ */
+
+namespace eval_detail
+{
+  // Строки доски по битам номера: сумма номеров строк фигур = popcount(m & X1) + 2 popcount(m & X2) + 4 popcount(m & X4)
+  const uint32_t ROWS_X1 = 0xF0F0F0F0u;
+  const uint32_t ROWS_X2 = 0xFF00FF00u;
+  const uint32_t ROWS_X4 = 0xFFFF0000u;
+
+  inline int row_sum(const uint32_t m)
+  {
+    return popcount(m & ROWS_X1) + 2 * popcount(m & ROWS_X2) + 4 * popcount(m & ROWS_X4);
+  }
+
+  // Отношение материала с точки зрения бота, white и black — веса сторон в целых единицах
+  inline double ratio(int white, int black, const bool first_bot_color)
+  {
+    if (!first_bot_color)
+      std::swap(white, black);
+    if (white == 0)
+      return INF;
+    if (black == 0)
+      return 0;
+    return double(black) / white;
+  }
+}
+
+/**
+ * Линейная оценка стороны: MAN за простую, KING за дамку и ADVANCE за каждую строку, пройденную простой
+ * Веса целые, поэтому и отдельная позиция (score), и блок позиций (eval_batch, EvalBatch.h) считаются в целых
+ */
+template <int MAN, int KING, int ADVANCE>
+struct LinearEval
+{
+  static const int man = MAN;
+  static const int king = KING;
+  static const int advance = ADVANCE;
+
+  static double score(const Position& pos, const bool first_bot_color)
+  {
+    const uint32_t w_men = pos.white & ~pos.kings, b_men = pos.black & ~pos.kings;
+    const int w = popcount(w_men), b = popcount(b_men);
+    const int wq = popcount(pos.white & pos.kings), bq = popcount(pos.black & pos.kings);
+    int white = MAN * w + KING * wq, black = MAN * b + KING * bq;
+    if (ADVANCE)
+    {
+      // Белые идут к строке 0, чёрные — к строке 7
+      white += ADVANCE * (7 * w - eval_detail::row_sum(w_men));
+      black += ADVANCE * eval_detail::row_sum(b_men);
+    }
+    return eval_detail::ratio(white, black, first_bot_color);
+  }
+};
+
+// Только количество фигур: простая — 1, дамка — 4
+struct NumberOnly : LinearEval<1, 4, 0>
+{
+};
+
+// Количество фигур и продвижение простых: простая — 1 + 0.05 за каждую пройденную строку, дамка — 5
+// Веса умножены на 20, чтобы считать в целых
+struct NumberAndPotential : LinearEval<20, 100, 1>
+{
+};
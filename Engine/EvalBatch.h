@@ -0,0 +1,216 @@
+﻿#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Eval.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CHECKERS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Функции с векторными командами собираются без общих флагов компилятора и вызываются, только если процессор их поддерживает
+#if defined(CHECKERS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CHECKERS_TARGET_SSE4 __attribute__((target("sse4.1")))
+#define CHECKERS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CHECKERS_TARGET_SSE4
+#define CHECKERS_TARGET_AVX2
+#endif
+
+/**
+ * Оценка блока позиций за один вызов: у горизонта — всех дочерних позиций узла,
+ * в инструментах — сохранённых позиций подряд
+ * Число простых и дамок, продвижение простых считаются сразу для 4 (SSE4) или 8 (AVX2) позиций,
+ * набор команд выбирается при первом вызове по процессору, без SSE4 работает обычный цикл
+ * Результат в точности совпадает с Eval::score для каждой позиции
+ */
+
+enum class SimdLevel
+{
+  SCALAR,
+  SSE4,
+  AVX2
+};
+
+// Лучший набор команд, поддерживаемый процессором
+inline SimdLevel detect_simd_level()
+{
+#if defined(CHECKERS_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+  __cpuid(info, 1);
+  const bool sse41 = (info[2] >> 19) & 1, osxsave = (info[2] >> 27) & 1, avx = (info[2] >> 28) & 1;
+  bool avx2 = false;
+  if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+  {
+    __cpuidex(info, 7, 0);
+    avx2 = (info[1] >> 5) & 1;
+  }
+  return avx2 ? SimdLevel::AVX2 : sse41 ? SimdLevel::SSE4 : SimdLevel::SCALAR;
+#elif defined(CHECKERS_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return SimdLevel::AVX2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return SimdLevel::SSE4;
+  return SimdLevel::SCALAR;
+#else
+  return SimdLevel::SCALAR;
+#endif
+}
+
+inline SimdLevel simd_level()
+{
+  static const SimdLevel level = detect_simd_level();
+  return level;
+}
+
+inline const char* simd_name(const SimdLevel level)
+{
+  return level == SimdLevel::AVX2 ? "AVX2" : level == SimdLevel::SSE4 ? "SSE4" : "scalar";
+}
+
+namespace eval_detail
+{
+  // Веса сторон в целых единицах для позиций [begin, end)
+  template <class Eval>
+  void side_weights_scalar(const uint32_t* white, const uint32_t* black, const uint32_t* kings,
+    const size_t begin, const size_t end, int* w_out, int* b_out)
+  {
+    for (size_t i = begin; i < end; ++i)
+    {
+      const uint32_t w_men = white[i] & ~kings[i], b_men = black[i] & ~kings[i];
+      const int w = popcount(w_men), b = popcount(b_men);
+      w_out[i] = Eval::man * w + Eval::king * popcount(white[i] & kings[i]) +
+        Eval::advance * (7 * w - row_sum(w_men));
+      b_out[i] = Eval::man * b + Eval::king * popcount(black[i] & kings[i]) + Eval::advance * row_sum(b_men);
+    }
+  }
+
+#ifdef CHECKERS_X86
+  // Число единичных битов в каждом 32-битном слове: по таблице для полубайтов, затем сумма байтов
+  CHECKERS_TARGET_SSE4 inline __m128i popcount_epi32(const __m128i v)
+  {
+    const __m128i lut = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low = _mm_set1_epi8(0x0F);
+    const __m128i bytes = _mm_add_epi8(_mm_shuffle_epi8(lut, _mm_and_si128(v, low)),
+      _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), low)));
+    return _mm_madd_epi16(_mm_maddubs_epi16(bytes, _mm_set1_epi8(1)), _mm_set1_epi16(1));
+  }
+
+  CHECKERS_TARGET_SSE4 inline __m128i row_sum_epi32(const __m128i m)
+  {
+    const __m128i x1 = popcount_epi32(_mm_and_si128(m, _mm_set1_epi32(int(ROWS_X1))));
+    const __m128i x2 = popcount_epi32(_mm_and_si128(m, _mm_set1_epi32(int(ROWS_X2))));
+    const __m128i x4 = popcount_epi32(_mm_and_si128(m, _mm_set1_epi32(int(ROWS_X4))));
+    return _mm_add_epi32(_mm_add_epi32(x1, _mm_slli_epi32(x2, 1)), _mm_slli_epi32(x4, 2));
+  }
+
+  template <class Eval>
+  CHECKERS_TARGET_SSE4 void side_weights_sse4(const uint32_t* white, const uint32_t* black, const uint32_t* kings,
+    const size_t n, int* w_out, int* b_out)
+  {
+    const __m128i man = _mm_set1_epi32(Eval::man), king = _mm_set1_epi32(Eval::king);
+    const __m128i advance = _mm_set1_epi32(Eval::advance), seven = _mm_set1_epi32(7);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(white + i));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(black + i));
+      const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kings + i));
+      const __m128i w_men = _mm_andnot_si128(k, w), b_men = _mm_andnot_si128(k, b);
+      const __m128i wm = popcount_epi32(w_men), bm = popcount_epi32(b_men);
+      const __m128i wk = popcount_epi32(_mm_and_si128(w, k)), bk = popcount_epi32(_mm_and_si128(b, k));
+      __m128i wv = _mm_add_epi32(_mm_mullo_epi32(man, wm), _mm_mullo_epi32(king, wk));
+      __m128i bv = _mm_add_epi32(_mm_mullo_epi32(man, bm), _mm_mullo_epi32(king, bk));
+      if (Eval::advance)
+      {
+        const __m128i w_adv = _mm_sub_epi32(_mm_mullo_epi32(seven, wm), row_sum_epi32(w_men));
+        wv = _mm_add_epi32(wv, _mm_mullo_epi32(advance, w_adv));
+        bv = _mm_add_epi32(bv, _mm_mullo_epi32(advance, row_sum_epi32(b_men)));
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(w_out + i), wv);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(b_out + i), bv);
+    }
+    side_weights_scalar<Eval>(white, black, kings, i, n, w_out, b_out);
+  }
+
+  CHECKERS_TARGET_AVX2 inline __m256i popcount_epi32(const __m256i v)
+  {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    const __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(v, low)),
+      _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+  }
+
+  CHECKERS_TARGET_AVX2 inline __m256i row_sum_epi32(const __m256i m)
+  {
+    const __m256i x1 = popcount_epi32(_mm256_and_si256(m, _mm256_set1_epi32(int(ROWS_X1))));
+    const __m256i x2 = popcount_epi32(_mm256_and_si256(m, _mm256_set1_epi32(int(ROWS_X2))));
+    const __m256i x4 = popcount_epi32(_mm256_and_si256(m, _mm256_set1_epi32(int(ROWS_X4))));
+    return _mm256_add_epi32(_mm256_add_epi32(x1, _mm256_slli_epi32(x2, 1)), _mm256_slli_epi32(x4, 2));
+  }
+
+  template <class Eval>
+  CHECKERS_TARGET_AVX2 void side_weights_avx2(const uint32_t* white, const uint32_t* black, const uint32_t* kings,
+    const size_t n, int* w_out, int* b_out)
+  {
+    const __m256i man = _mm256_set1_epi32(Eval::man), king = _mm256_set1_epi32(Eval::king);
+    const __m256i advance = _mm256_set1_epi32(Eval::advance), seven = _mm256_set1_epi32(7);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(white + i));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(black + i));
+      const __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kings + i));
+      const __m256i w_men = _mm256_andnot_si256(k, w), b_men = _mm256_andnot_si256(k, b);
+      const __m256i wm = popcount_epi32(w_men), bm = popcount_epi32(b_men);
+      const __m256i wk = popcount_epi32(_mm256_and_si256(w, k)), bk = popcount_epi32(_mm256_and_si256(b, k));
+      __m256i wv = _mm256_add_epi32(_mm256_mullo_epi32(man, wm), _mm256_mullo_epi32(king, wk));
+      __m256i bv = _mm256_add_epi32(_mm256_mullo_epi32(man, bm), _mm256_mullo_epi32(king, bk));
+      if (Eval::advance)
+      {
+        const __m256i w_adv = _mm256_sub_epi32(_mm256_mullo_epi32(seven, wm), row_sum_epi32(w_men));
+        wv = _mm256_add_epi32(wv, _mm256_mullo_epi32(advance, w_adv));
+        bv = _mm256_add_epi32(bv, _mm256_mullo_epi32(advance, row_sum_epi32(b_men)));
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(w_out + i), wv);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(b_out + i), bv);
+    }
+    side_weights_scalar<Eval>(white, black, kings, i, n, w_out, b_out);
+  }
+#endif
+}
+
+/**
+ * Оценки n позиций, заданных тремя массивами битовых досок, с точки зрения first_bot_color (как Eval::score)
+ * level — набор команд, по умолчанию лучший доступный (другой задаётся для замеров)
+ */
+template <class Eval>
+void eval_batch(const uint32_t* white, const uint32_t* black, const uint32_t* kings, const size_t n,
+  const bool first_bot_color, double* out, const SimdLevel level = simd_level())
+{
+  const size_t CHUNK = 256;
+  int w[CHUNK], b[CHUNK];
+  for (size_t begin = 0; begin < n; begin += CHUNK)
+  {
+    const size_t count = (n - begin < CHUNK) ? n - begin : CHUNK;
+#ifdef CHECKERS_X86
+    if (level == SimdLevel::AVX2)
+      eval_detail::side_weights_avx2<Eval>(white + begin, black + begin, kings + begin, count, w, b);
+    else if (level == SimdLevel::SSE4)
+      eval_detail::side_weights_sse4<Eval>(white + begin, black + begin, kings + begin, count, w, b);
+    else
+#endif
+      eval_detail::side_weights_scalar<Eval>(white + begin, black + begin, kings + begin, 0, count, w, b);
+    for (size_t i = 0; i < count; ++i)
+      out[begin + i] = eval_detail::ratio(w[i], b[i], first_bot_color);
+  }
+}
@@ -0,0 +1,460 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../Models/BotSettings.h"
+#include "../Models/Move.h"
+#include "Book.h"
+#include "Search.h"
+#include "SearchStats.h"
+#include "Tablebase.h"
+#include "TransTable.h"
+
+// Ограничения поиска сверх глубины Logic::Max_depth
+struct search_limits
+{
+  int time_ms = 0;        // Бюджет времени, мс (0 — без ограничения), по умолчанию BotTimeMS из настроек
+  size_t nodes = 0;       // Бюджет узлов всех потоков (0 — без ограничения)
+  bool iterate = false;   // Углублять поиск по одной глубине и без бюджетов, чтобы сообщать о каждой итерации
+};
+
+/**
+ * Логика игры и поиск хода ИИ
+ * Не зависит от SDL и формата настроек: доска передаётся матрицей 8x8, настройки — структурой bot_settings
+ */
+class Logic
+{
+public:
+  // Конструктор. Инициализирует настройки и генератор случайных чисел
+  explicit Logic(const bot_settings& settings) : settings(settings)
+  {
+    rand_eng = std::default_random_engine(settings.no_random ? 0 : settings.seed ? settings.seed : unsigned(time(0)));
+    limits.time_ms = settings.time_limit_ms;
+    // Без оптимизации таблица транспозиций не используется
+    if (settings.optimization != "O0")
+      tt.resize(settings.hash_size_mb);
+    // Файла таблиц может не быть, тогда эндшпиль ищется обычным перебором
+    if (!settings.tablebase_path.empty())
+      tb.open(settings.tablebase_path);
+    if (!settings.book_path.empty())
+      book.open(settings.book_path);
+
+    // Потоки поиска: 0 — по числу ядер
+    // Оценочная функция выбирается здесь один раз, дальше поиск специализирован под неё
+    unsigned threads = settings.threads;
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; ++i)
+      workers.push_back(make_search(settings.scoring_mode, settings.optimization, settings.quiescence, unsigned(rand_eng())));
+  }
+
+  // Перед перемещением фоновые поиски останавливаются: они ссылаются на поля объекта
+  Logic(Logic&& other) noexcept
+  {
+    other.cancel_search();
+    other.stop_pondering();
+    move_from(other);
+  }
+
+  Logic& operator=(Logic&& other) noexcept
+  {
+    if (this != &other)
+    {
+      cancel_search();
+      stop_pondering();
+      other.cancel_search();
+      other.stop_pondering();
+      move_from(other);
+    }
+    return *this;
+  }
+
+  ~Logic()
+  {
+    cancel_search();
+    stop_pondering();
+  }
+
+  /**
+   * Находит последовательность лучших ходов для заданного цвета
+   * Возвращает вектор ходов, ведущих к наилучшей оценке позиции
+   * Если задан бюджет времени или узлов (limits), глубина наращивается 0, 1, 2, ... до Max_depth,
+   * пока он не кончится, и возвращается результат последней завершённой итерации
+   * Первая итерация всегда завершается, поэтому бюджет может быть превышен на её размер
+   * При нескольких потоках (Lazy SMP) вспомогательные потоки ищут ту же позицию
+   * со своим порядком ходов и наполняют общую таблицу транспозиций, ход выбирает главный поток
+   * Позиции из дебютной книги не ищутся: ход берётся из книги
+   * Если соперник сыграл предсказанный ход и обдумывание успело дойти до Max_depth, его результат
+   * возвращается сразу, иначе поиск идёт заново, но по уже заполненной таблице транспозиций
+   * Счётчики поиска, давшего ход, доступны через last_stats()
+   */
+  std::vector<move_pos> find_best_turns(const bool color, const std::vector<std::vector<POS_T>>& mtx)
+  {
+    return find_best_turns(color, mtx, nullptr);
+  }
+
+  /**
+   * find_best_turns, on_iteration вызывается в этом же потоке после каждой завершённой итерации поиска
+   * с её итогом: оценкой корня и лучшей последовательностью ходов (ход из книги или обдумывания итераций не даёт)
+   */
+  std::vector<move_pos> find_best_turns(const bool color, const std::vector<std::vector<POS_T>>& mtx,
+    const std::function<void(const search_info&)>& on_iteration)
+  {
+    const Position pos = Position::from_mtx(mtx);
+    stop_pondering();
+    const bool ponder_hit = ponder_ready && ponder_pos == pos && ponder_color == color && ponder_depth == Max_depth;
+    ponder_ready = false;
+    if (ponder_hit && workers[0]->depth_reached == Max_depth && !workers[0]->best_sequence.empty())
+    {
+      collect_stats("ponder");
+      return workers[0]->best_sequence;
+    }
+
+    if (book.is_open())
+    {
+      auto book_turns = book.choose(pos, color, settings.no_random ? nullptr : &rand_eng);
+      if (!book_turns.empty())
+      {
+        stats = search_stats();
+        stats.source = "book";
+        return book_turns;
+      }
+    }
+
+    search_shared shared;
+    shared.time_limit_ms = limits.time_ms;
+    shared.node_limit = limits.nodes;
+    shared.cancel = &search_cancel;
+    shared.on_iteration = on_iteration;
+    const bool iterate = limits.time_ms > 0 || limits.nodes > 0 || limits.iterate || workers.size() > 1;
+    const int first_depth = iterate ? 0 : Max_depth;
+    run_search(shared, pos, color, first_depth, Max_depth);
+    collect_stats("search");
+    return workers[0]->best_sequence;
+  }
+
+  /**
+   * Запускает find_best_turns в отдельном потоке, результат передаётся через future
+   * on_progress вызывается из потока поиска после каждой завершённой итерации с её итогом,
+   * on_done — из него же, когда результат уже передан в future (в том числе после отмены)
+   * Пока поиск идёт, из других потоков можно вызывать только cancel_search
+   */
+  std::future<std::vector<move_pos>> find_best_turns_async(const bool color, const std::vector<std::vector<POS_T>>& mtx,
+    std::function<void(const search_info&)> on_progress = nullptr, std::function<void()> on_done = nullptr)
+  {
+    cancel_search();
+    std::promise<std::vector<move_pos>> promise;
+    auto result = promise.get_future();
+    search_thread = std::thread([this, color, mtx, on_progress, on_done](std::promise<std::vector<move_pos>> promise)
+      {
+        try
+        {
+          promise.set_value(find_best_turns(color, mtx, on_progress));
+        }
+        catch (...)
+        {
+          promise.set_exception(std::current_exception());
+        }
+        if (on_done)
+          on_done();
+      }, std::move(promise));
+    return result;
+  }
+
+  /**
+   * Прерывает поиск, запущенный find_best_turns_async, и дожидается завершения его потока
+   * Поиск проверяет флаг отмены раз в 1024 узла, поэтому останавливается за доли миллисекунды
+   * future получает ходы последней завершённой итерации; если не завершилась ни одна, ходов нет
+   */
+  void cancel_search()
+  {
+    if (!search_thread.joinable())
+      return;
+    search_cancel = true;
+    search_thread.join();
+    search_cancel = false;
+  }
+
+  /**
+   * Начинает обдумывание на время хода соперника: color — цвет бота, mtx — доска с ходом соперника,
+   * depth — уровень бота
+   * В фоновом потоке предсказывается ответ соперника (поиск на два хода мельче) и ищется ход бота
+   * в позиции после него. Результат забирает следующий вызов find_best_turns
+   */
+  void start_pondering(const bool color, const std::vector<std::vector<POS_T>>& mtx, const int depth)
+  {
+    stop_pondering();
+    ponder_ready = false;
+    if (!settings.ponder)
+      return;
+    ponder_pos = Position::from_mtx(mtx);
+    ponder_color = color;
+    ponder_depth = depth;
+    ponder_cancel = false;
+    ponder_thread = std::thread([this]()
+      {
+        // Предсказание хода соперника
+        Position pos = ponder_pos;
+        search_shared predict;
+        predict.cancel = &ponder_cancel;
+        run_search(predict, pos, !ponder_color, 0, std::max(0, ponder_depth - 2));
+        const auto reply = workers[0]->best_sequence;
+        if (ponder_cancel || reply.empty())
+          return;
+        for (const auto& turn : reply)
+          pos.apply(sq_move(turn));
+        ponder_pos = pos;
+        ponder_ready = true;
+        // Ход бота в позиции после предсказанного ответа, глубина растёт, пока соперник думает
+        search_shared shared;
+        shared.cancel = &ponder_cancel;
+        run_search(shared, pos, ponder_color, 0, ponder_depth);
+      });
+  }
+
+  // Останавливает обдумывание (ход соперника сделан, отмена хода, новая партия или выход)
+  void stop_pondering()
+  {
+    ponder_cancel = true;
+    if (ponder_thread.joinable())
+      ponder_thread.join();
+  }
+
+  // Новая партия: прошлые позиции из таблицы транспозиций больше не пригодятся
+  void new_game()
+  {
+    cancel_search();
+    stop_pondering();
+    ponder_ready = false;
+    tt.clear();
+  }
+
+  // Счётчики поиска последнего хода, найденного find_best_turns
+  const search_stats& last_stats() const
+  {
+    return stats;
+  }
+
+  // Все найденные ходы
+  std::vector<move_pos> turns;
+
+  // Есть ли хотя бы один бой
+  bool have_beats;
+
+  // Глубина поиска (для ИИ), при ограничении по времени — максимальная
+  int Max_depth;
+
+  // Бюджеты следующих поисков, можно менять между вызовами find_best_turns
+  search_limits limits;
+
+  // Находит все возможные ходы для заданного цвета
+  void find_turns(const bool color, const std::vector<std::vector<POS_T>>& mtx)
+  {
+    std::vector<move_pos> res_turns;
+    bool have_beats_before = false;
+    for (POS_T i = 0; i < 8; ++i)
+    {
+      for (POS_T j = 0; j < 8; ++j)
+      {
+        if (mtx[i][j] && mtx[i][j] % 2 != color)
+        {
+          find_turns(i, j, mtx);
+          if (have_beats && !have_beats_before)
+          {
+            have_beats_before = true;
+            res_turns.clear();
+          }
+          if ((have_beats_before && have_beats) || !have_beats_before)
+          {
+            res_turns.insert(res_turns.end(), turns.begin(), turns.end());
+          }
+        }
+      }
+    }
+    turns = res_turns;
+    std::shuffle(turns.begin(), turns.end(), rand_eng);
+    have_beats = have_beats_before;
+  }
+
+  // Находит возможные ходы для фигуры по координатам
+  void find_turns(const POS_T x, const POS_T y, const std::vector<std::vector<POS_T>>& mtx)
+  {
+    turns.clear();
+    have_beats = false;
+    POS_T type = mtx[x][y];
+    switch (type)
+    {
+    case 1:
+    case 2:
+      for (POS_T i = x - 2; i <= x + 2; i += 4)
+      {
+        for (POS_T j = y - 2; j <= y + 2; j += 4)
+        {
+          if (i < 0 || i > 7 || j < 0 || j > 7)
+            continue;
+          POS_T xb = (x + i) / 2, yb = (y + j) / 2;
+          if (mtx[i][j] || !mtx[xb][yb] || mtx[xb][yb] % 2 == type % 2)
+            continue;
+          turns.emplace_back(x, y, i, j, xb, yb);
+        }
+      }
+      break;
+    default:
+      for (POS_T i = -1; i <= 1; i += 2)
+      {
+        for (POS_T j = -1; j <= 1; j += 2)
+        {
+          POS_T xb = -1, yb = -1;
+          for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
+          {
+            if (mtx[i2][j2])
+            {
+              if (mtx[i2][j2] % 2 == type % 2 || (mtx[i2][j2] % 2 != type % 2 && xb != -1))
+                break;
+              xb = i2;
+              yb = j2;
+            }
+            if (xb != -1 && xb != i2)
+            {
+              turns.emplace_back(x, y, i2, j2, xb, yb);
+            }
+          }
+        }
+      }
+      break;
+    }
+    if (!turns.empty())
+    {
+      have_beats = true;
+      return;
+    }
+    switch (type)
+    {
+    case 1:
+    case 2:
+    {
+      POS_T i = ((type % 2) ? x - 1 : x + 1);
+      for (POS_T j = y - 1; j <= y + 1; j += 2)
+      {
+        if (i < 0 || i > 7 || j < 0 || j > 7 || mtx[i][j])
+          continue;
+        turns.emplace_back(x, y, i, j);
+      }
+      break;
+    }
+    default:
+      for (POS_T i = -1; i <= 1; i += 2)
+      {
+        for (POS_T j = -1; j <= 1; j += 2)
+        {
+          for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
+          {
+            if (mtx[i2][j2])
+              break;
+            turns.emplace_back(x, y, i2, j2);
+          }
+        }
+      }
+      break;
+    }
+  }
+
+private:
+  /**
+   * Поиск всеми потоками от first_depth до max_depth, результат — в workers[0]
+   * Без бюджета времени и с одним потоком ищется сразу полная глубина
+   */
+  void run_search(search_shared& shared, const Position& pos, const bool color, const int first_depth, const int max_depth)
+  {
+    tt.new_search();
+    shared.tt = &tt;
+    shared.tb = tb.is_open() ? &tb : nullptr;
+    shared.start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < workers.size(); ++i)
+    {
+      // Половина вспомогательных потоков начинает на ход глубже, чтобы потоки расходились по глубинам
+      const int helper_depth = std::min(max_depth, first_depth + int(i % 2));
+      helpers.emplace_back(&SearchBase::run, workers[i].get(), std::ref(shared), std::cref(pos), color,
+        helper_depth, max_depth, false);
+    }
+    workers[0]->run(shared, pos, color, first_depth, max_depth, true);
+    shared.stop = true;
+    for (auto& th : helpers)
+      th.join();
+    search_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shared.start).count();
+  }
+
+  // Сумма счётчиков всех потоков после run_search, глубина — главного потока
+  void collect_stats(const char* source)
+  {
+    stats = search_stats();
+    stats.source = source;
+    stats.depth = workers[0]->depth_reached;
+    stats.time_ms = search_ms;
+    for (const auto& w : workers)
+      stats += w->stats;
+  }
+
+  void move_from(Logic& other)
+  {
+    turns = std::move(other.turns);
+    have_beats = other.have_beats;
+    Max_depth = other.Max_depth;
+    limits = other.limits;
+    rand_eng = other.rand_eng;
+    settings = std::move(other.settings);
+    tt = std::move(other.tt);
+    tb = std::move(other.tb);
+    book = std::move(other.book);
+    workers = std::move(other.workers);
+    stats = std::move(other.stats);
+    search_ms = other.search_ms;
+  }
+
+  // Генератор случайных чисел
+  std::default_random_engine rand_eng;
+
+  // Настройки поиска
+  bot_settings settings;
+
+  // Таблица транспозиций, общая для всех потоков
+  TransTable tt;
+
+  // Эндшпильные таблицы, отображённые в память только для чтения
+  Tablebase tb;
+
+  // Дебютная книга, отображённая в память только для чтения
+  OpeningBook book;
+
+  // Поиск в каждом потоке
+  std::vector<std::unique_ptr<SearchBase>> workers;
+
+  // Счётчики последнего хода и время последнего run_search
+  search_stats stats;
+  double search_ms = 0;
+
+  // Поток поиска, запущенного find_best_turns_async, и флаг его отмены
+  std::thread search_thread;
+  std::atomic<bool> search_cancel{ false };
+
+  // Обдумывание на время хода соперника: фоновый поток, флаг его отмены,
+  // позиция после предсказанного ответа соперника (ponder_ready — ответ найден), цвет и уровень бота
+  // Поля, кроме флага отмены, читаются только после завершения потока
+  std::thread ponder_thread;
+  std::atomic<bool> ponder_cancel{ false };
+  bool ponder_ready = false;
+  Position ponder_pos;
+  bool ponder_color = false;
+  int ponder_depth = 0;
+};
@@ -0,0 +1,150 @@
+﻿#pragma once
+#include <stdint.h>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Файл, отображённый в память только для чтения (mmap / MapViewOfFile)
+ * Страницы подгружаются по мере обращения и общие для всех процессов, открывших тот же файл
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept
+  {
+    swap(other);
+  }
+
+  MappedFile& operator=(MappedFile&& other) noexcept
+  {
+    if (this != &other)
+    {
+      close();
+      swap(other);
+    }
+    return *this;
+  }
+
+  ~MappedFile()
+  {
+    close();
+  }
+
+  // Отображает файл целиком, при ошибке возвращает false
+  bool open(const std::string& path)
+  {
+    close();
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      file = nullptr;
+      return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+      close();
+      return false;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+      close();
+      return false;
+    }
+    ptr = static_cast<const uint8_t*>(view);
+    length = size_t(file_size.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+      ::close(fd);
+      return false;
+    }
+    void* view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+      return false;
+    ptr = static_cast<const uint8_t*>(view);
+    length = size_t(st.st_size);
+#endif
+    return true;
+  }
+
+  void close()
+  {
+#ifdef _WIN32
+    if (ptr)
+      UnmapViewOfFile(ptr);
+    if (mapping)
+      CloseHandle(mapping);
+    if (file)
+      CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (ptr)
+      munmap(const_cast<uint8_t*>(ptr), length);
+#endif
+    ptr = nullptr;
+    length = 0;
+  }
+
+  bool is_open() const
+  {
+    return ptr != nullptr;
+  }
+
+  const uint8_t* data() const
+  {
+    return ptr;
+  }
+
+  size_t size() const
+  {
+    return length;
+  }
+
+private:
+  void swap(MappedFile& other)
+  {
+    std::swap(ptr, other.ptr);
+    std::swap(length, other.length);
+#ifdef _WIN32
+    std::swap(file, other.file);
+    std::swap(mapping, other.mapping);
+#endif
+  }
+
+  const uint8_t* ptr = nullptr;
+  size_t length = 0;
+#ifdef _WIN32
+  HANDLE file = nullptr;
+  HANDLE mapping = nullptr;
+#endif
+};
@@ -0,0 +1,254 @@
+﻿#pragma once
+#include <vector>
+
+#include "../Models/Position.h"
+
+// Максимальное число ходов в одной позиции
+const int MAX_MOVES = 192;
+
+/**
+ * Список ходов фиксированной ёмкости
+ * Хранится на стеке, поэтому генерация не выделяет память в куче
+ */
+struct move_list
+{
+  sq_move moves[MAX_MOVES];
+  int size = 0;
+  bool have_beats = false;  // Все ходы в списке — взятия
+
+  void add(const SQ_T from, const SQ_T to, const SQ_T beat = NO_SQ)
+  {
+    moves[size++] = sq_move(from, to, beat);
+  }
+
+  bool empty() const
+  {
+    return size == 0;
+  }
+
+  sq_move* begin()
+  {
+    return moves;
+  }
+
+  sq_move* end()
+  {
+    return moves + size;
+  }
+
+  const sq_move* begin() const
+  {
+    return moves;
+  }
+
+  const sq_move* end() const
+  {
+    return moves + size;
+  }
+
+  sq_move& operator[](const int i)
+  {
+    return moves[i];
+  }
+
+  const sq_move& operator[](const int i) const
+  {
+    return moves[i];
+  }
+};
+
+// Взятия дамкой с клетки s: по каждой диагонали до первой фигуры соперника и все свободные клетки за ней
+inline void add_king_beats(const Position& pos, const SQ_T s, const uint32_t opp, move_list& list)
+{
+  const uint32_t empty = pos.empty();
+  for (int dir = 0; dir < 4; ++dir)
+  {
+    SQ_T c = neighbour(s, dir);
+    while (c != NO_SQ && (empty & sq_bit(c)))
+      c = neighbour(c, dir);
+    if (c == NO_SQ || !(opp & sq_bit(c)))
+      continue;
+    const SQ_T beat = c;
+    for (c = neighbour(c, dir); c != NO_SQ && (empty & sq_bit(c)); c = neighbour(c, dir))
+      list.add(s, c, beat);
+  }
+}
+
+// Тихие ходы дамки с клетки s
+inline void add_king_moves(const Position& pos, const SQ_T s, move_list& list)
+{
+  const uint32_t empty = pos.empty();
+  for (int dir = 0; dir < 4; ++dir)
+  {
+    for (SQ_T c = neighbour(s, dir); c != NO_SQ && (empty & sq_bit(c)); c = neighbour(c, dir))
+      list.add(s, c);
+  }
+}
+
+/**
+ * Находит все ходы стороны color сразу для всех фигур
+ * Ходы простых шашек получаются сдвигами масок, ходы дамок — проходом по диагоналям
+ * Если есть хотя бы одно взятие, в список попадают только взятия
+ */
+inline void gen_moves(const Position& pos, const bool color, move_list& list)
+{
+  list.size = 0;
+  const uint32_t own = pos.pieces(color), opp = pos.pieces(!color), empty = pos.empty();
+  const uint32_t men = own & ~pos.kings;
+  uint32_t kings = own & pos.kings;
+
+  // Взятия простыми шашками во всех четырёх направлениях
+  for (int dir = 0; dir < 4; ++dir)
+  {
+    uint32_t targets = step(step(men, dir) & opp, dir) & empty;
+    const int back = opposite(dir);
+    while (targets)
+    {
+      const SQ_T to = pop_lsb(targets);
+      const SQ_T beat = neighbour(to, back);
+      list.add(neighbour(beat, back), to, beat);
+    }
+  }
+  for (uint32_t k = kings; k;)
+    add_king_beats(pos, pop_lsb(k), opp, list);
+
+  list.have_beats = !list.empty();
+  if (list.have_beats)
+    return;
+
+  // Тихие ходы простых шашек только вперёд: белые вверх, чёрные вниз
+  for (int dir = (color ? DL : UL); dir <= (color ? DR : UR); ++dir)
+  {
+    uint32_t targets = step(men, dir) & empty;
+    const int back = opposite(dir);
+    while (targets)
+    {
+      const SQ_T to = pop_lsb(targets);
+      list.add(neighbour(to, back), to);
+    }
+  }
+  while (kings)
+    add_king_moves(pos, pop_lsb(kings), list);
+}
+
+// Есть ли у стороны color хотя бы одно взятие (без построения списка ходов)
+inline bool has_beats(const Position& pos, const bool color)
+{
+  const uint32_t own = pos.pieces(color), opp = pos.pieces(!color), empty = pos.empty();
+  const uint32_t men = own & ~pos.kings;
+  for (int dir = 0; dir < 4; ++dir)
+  {
+    if (step(step(men, dir) & opp, dir) & empty)
+      return true;
+  }
+  for (uint32_t k = own & pos.kings; k;)
+  {
+    const SQ_T s = pop_lsb(k);
+    for (int dir = 0; dir < 4; ++dir)
+    {
+      SQ_T c = neighbour(s, dir);
+      while (c != NO_SQ && (empty & sq_bit(c)))
+        c = neighbour(c, dir);
+      if (c == NO_SQ || !(opp & sq_bit(c)))
+        continue;
+      c = neighbour(c, dir);
+      if (c != NO_SQ && (empty & sq_bit(c)))
+        return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Находит продолжения серии взятий для фигуры на клетке s
+ * В список попадают только взятия
+ */
+inline void gen_beats_from(const Position& pos, const SQ_T s, move_list& list)
+{
+  list.size = 0;
+  const uint32_t bit = sq_bit(s);
+  const uint32_t opp = (pos.white & bit) ? pos.black : pos.white;
+  if (pos.kings & bit)
+  {
+    add_king_beats(pos, s, opp, list);
+  }
+  else
+  {
+    const uint32_t empty = pos.empty();
+    for (int dir = 0; dir < 4; ++dir)
+    {
+      const SQ_T beat = neighbour(s, dir);
+      if (beat == NO_SQ || !(opp & sq_bit(beat)))
+        continue;
+      const SQ_T to = neighbour(beat, dir);
+      if (to != NO_SQ && (empty & sq_bit(to)))
+        list.add(s, to, beat);
+    }
+  }
+  list.have_beats = !list.empty();
+}
+
+/**
+ * Перебирает позиции после каждого полного хода стороны color: серия взятий считается одним ходом
+ * f(pos) вызывается для позиции после хода, затем ход отменяется
+ * Возвращает число полных ходов
+ */
+template <class F>
+int for_each_turn(Position& pos, const bool color, F&& f, const SQ_T s = NO_SQ)
+{
+  move_list list;
+  if (s == NO_SQ)
+    gen_moves(pos, color, list);
+  else
+    gen_beats_from(pos, s, list);
+  if (s != NO_SQ && list.empty())
+  {
+    f(pos);
+    return 1;
+  }
+  int count = 0;
+  for (const auto& turn : list)
+  {
+    undo_info undo;
+    pos.make(turn, undo);
+    if (turn.beat != NO_SQ)
+      count += for_each_turn(pos, color, f, turn.to);
+    else
+    {
+      f(pos);
+      ++count;
+    }
+    pos.unmake(turn, undo);
+  }
+  return count;
+}
+
+/**
+ * Перебирает полные ходы стороны color вместе с шагами: f(steps, pos) получает шаги хода
+ * и позицию после него, затем ход отменяется. Если f вернёт true, перебор прекращается
+ * Возвращает true, если перебор прекращён
+ */
+template <class F>
+bool for_each_series(Position& pos, const bool color, F&& f, std::vector<sq_move>& steps, const SQ_T s = NO_SQ)
+{
+  move_list list;
+  if (s == NO_SQ)
+    gen_moves(pos, color, list);
+  else
+    gen_beats_from(pos, s, list);
+  if (s != NO_SQ && list.empty())
+    return f(static_cast<const std::vector<sq_move>&>(steps), static_cast<const Position&>(pos));
+  for (const auto& turn : list)
+  {
+    undo_info undo;
+    pos.make(turn, undo);
+    steps.push_back(turn);
+    const bool done = (turn.beat != NO_SQ) ? for_each_series(pos, color, f, steps, turn.to)
+      : f(static_cast<const std::vector<sq_move>&>(steps), static_cast<const Position&>(pos));
+    steps.pop_back();
+    pos.unmake(turn, undo);
+    if (done)
+      return true;
+  }
+  return false;
+}
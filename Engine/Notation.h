@@ -0,0 +1,140 @@
+﻿#pragma once
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../Models/Position.h"
+
+/**
+ * Текстовая запись клеток, ходов и позиций
+ * Клетки в алгебраической нотации: a1 — левый нижний угол со стороны белых (клетка матрицы (7, 0))
+ * Позиции в формате FEN из PDN: "W:Wa1,c1,Ke5:Bb8,d8" — очередь хода, белые и чёрные фигуры, K — дамка
+ */
+
+// Имя клетки, например "c3"
+inline std::string sq_name(const SQ_T s)
+{
+  return std::string(1, char('a' + sq_y(s))) + char('8' - sq_x(s));
+}
+
+// Номер клетки по букве и цифре имени, NO_SQ если имя неверно или клетка светлая
+inline SQ_T parse_sq(const char file, const char rank)
+{
+  if (file < 'a' || file > 'h' || rank < '1' || rank > '8')
+    return NO_SQ;
+  const POS_T x = POS_T('8' - rank), y = POS_T(file - 'a');
+  return (x + y) % 2 ? to_sq(x, y) : NO_SQ;
+}
+
+// Номер клетки по имени, NO_SQ если имя неверно или клетка светлая
+inline SQ_T parse_sq(const std::string& name)
+{
+  return name.size() == 2 ? parse_sq(name[0], name[1]) : NO_SQ;
+}
+
+// Запись хода целиком: "c3-d4" или серия взятий "c3:e5:g3"
+inline std::string turn_name(const std::vector<sq_move>& series)
+{
+  if (series.empty())
+    return "";
+  std::string res = sq_name(series[0].from);
+  for (const auto& turn : series)
+    res += (turn.beat != NO_SQ ? ":" : "-") + sq_name(turn.to);
+  return res;
+}
+
+/**
+ * Клетки записи хода text длиной len: "c3-d4", "c3:e5:g3" или "c3xg3" (разделители не различаются)
+ * false — запись неверна; проверить ход по позиции можно через match_turn (Pdn.h)
+ */
+inline bool parse_turn_squares(const char* text, const size_t len, std::vector<SQ_T>& squares)
+{
+  squares.clear();
+  for (size_t j = 0; j <= len; j += 3)
+  {
+    const SQ_T s = (j + 2 <= len) ? parse_sq(text[j], text[j + 1]) : NO_SQ;
+    if (s == NO_SQ || (j + 2 < len && text[j + 2] != '-' && text[j + 2] != ':' && text[j + 2] != 'x'))
+      return false;
+    squares.push_back(s);
+    if (j + 2 == len)
+      break;
+  }
+  return squares.size() >= 2;
+}
+
+// Позиция в FEN
+inline std::string to_fen(const Position& pos, const bool color)
+{
+  std::string res = color ? "B" : "W";
+  for (const bool side : { false, true })
+  {
+    res += side ? ":B" : ":W";
+    bool first = true;
+    for (uint32_t b = pos.pieces(side); b;)
+    {
+      const SQ_T s = pop_lsb(b);
+      res += (first ? "" : ",") + std::string((pos.kings & sq_bit(s)) ? "K" : "") + sq_name(s);
+      first = false;
+    }
+  }
+  return res;
+}
+
+/**
+ * Разбор FEN, color — чья очередь хода (0 — белые, 1 — чёрные)
+ * При ошибке бросает runtime_error
+ */
+inline Position parse_fen(const std::string& fen, bool& color)
+{
+  Position pos;
+  std::vector<std::string> parts;
+  size_t start = 0;
+  for (size_t i = 0; i <= fen.size(); ++i)
+  {
+    if (i == fen.size() || fen[i] == ':')
+    {
+      parts.push_back(fen.substr(start, i - start));
+      start = i + 1;
+    }
+  }
+  if (parts.size() != 3 || (parts[0] != "W" && parts[0] != "B"))
+    throw std::runtime_error("bad FEN: " + fen);
+  color = (parts[0] == "B");
+  for (size_t p = 1; p < 3; ++p)
+  {
+    const std::string& list = parts[p];
+    if (list.empty() || (list[0] != 'W' && list[0] != 'B'))
+      throw std::runtime_error("bad FEN piece list: " + list);
+    const bool side = (list[0] == 'B');
+    size_t i = 1;
+    while (i < list.size())
+    {
+      size_t j = list.find(',', i);
+      if (j == std::string::npos)
+        j = list.size();
+      std::string item = list.substr(i, j - i);
+      i = j + 1;
+      if (item.empty())
+        continue;
+      const bool king = (item[0] == 'K');
+      const SQ_T s = parse_sq(king ? item.substr(1) : item);
+      if (s == NO_SQ || !(pos.empty() & sq_bit(s)))
+        throw std::runtime_error("bad FEN square: " + item);
+      (side ? pos.black : pos.white) |= sq_bit(s);
+      if (king)
+        pos.kings |= sq_bit(s);
+    }
+  }
+  pos.update_hash();
+  return pos;
+}
+
+// Начальная позиция
+inline Position start_position()
+{
+  Position pos;
+  pos.black = 0x00000FFFu;
+  pos.white = 0xFFF00000u;
+  pos.update_hash();
+  return pos;
+}
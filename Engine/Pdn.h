@@ -0,0 +1,530 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "../Models/Position.h"
+#include "MoveGen.h"
+#include "Notation.h"
+
+/**
+ * Партии в PDN (Portable Draughts Notation), русские шашки (GameType 25)
+ * Ходы в алгебраической записи: "c3-d4", серия взятий "c3:e5:g3". При чтении взятие можно записать
+ * через "x" и пропустить промежуточные поля ("c3xg3"), если ход от этого не становится неоднозначным
+ * Итог партии: "2-0" — победа белых, "0-2" — победа чёрных, "1-1" — ничья, "*" — партия не закончена
+ */
+
+// Размер кусков, которыми читается поток
+const size_t PDN_CHUNK = 1 << 16;
+// Предел текста одной партии: дальше ходы не разбираются, память на партию ограничена
+const size_t PDN_MAX_GAME = 1 << 20;
+// Предел длины значения тега и слова в тексте ходов
+const size_t PDN_MAX_TOKEN = 4096;
+
+// Партия: теги, начальная позиция и полные ходы (серия взятий — один ход из нескольких шагов)
+struct pdn_game
+{
+  std::vector<std::pair<std::string, std::string>> tags;  // Теги в порядке записи
+  Position start = start_position();                     // Начальная позиция (тег FEN)
+  bool start_color = false;                              // Чей первый ход: 0 — белые
+  std::vector<std::vector<sq_move>> turns;
+  std::string result = "*";
+  std::string error;                                     // Ошибка разбора, ходы прочитаны только до неё
+
+  // Значение тега, пусто — тега нет
+  std::string tag(const std::string& name) const
+  {
+    for (const auto& t : tags)
+    {
+      if (t.first == name)
+        return t.second;
+    }
+    return "";
+  }
+
+  void set_tag(const std::string& name, const std::string& value)
+  {
+    for (auto& t : tags)
+    {
+      if (t.first == name)
+      {
+        t.second = value;
+        return;
+      }
+    }
+    tags.emplace_back(name, value);
+  }
+
+  // Позиция после всех ходов
+  Position final_position() const
+  {
+    Position pos = start;
+    for (const auto& turn : turns)
+    {
+      for (const auto& step : turn)
+        pos.apply(step);
+    }
+    return pos;
+  }
+
+  void clear()
+  {
+    tags.clear();
+    start = start_position();
+    start_color = false;
+    turns.clear();
+    result = "*";
+    error.clear();
+  }
+};
+
+/**
+ * Находит полный ход стороны color по клеткам squares: первая и последняя клетки обязательны,
+ * промежуточные поля серии взятий можно пропускать. Шаги хода записываются в steps
+ * Ход, в котором перечислены все поля, предпочтительнее; из сокращённых подходящих берётся первый
+ * false — такого хода нет
+ */
+inline bool match_turn(Position& pos, const bool color, const std::vector<SQ_T>& squares, std::vector<sq_move>& steps)
+{
+  steps.clear();
+  if (squares.size() < 2)
+    return false;
+  // Без взятий ход — один шаг по диагонали: простая шашка на клетку вперёд, дамка на любую свободную
+  if (!has_beats(pos, color))
+  {
+    const SQ_T from = squares[0], to = squares[1];
+    if (squares.size() != 2 || !(pos.pieces(color) & sq_bit(from)))
+      return false;
+    const bool king = pos.kings & sq_bit(from);
+    for (int dir = UL; dir <= DR; ++dir)
+    {
+      if (!king && dir != (color ? DL : UL) && dir != (color ? DR : UR))
+        continue;
+      for (SQ_T s = neighbour(from, dir); s != NO_SQ && (pos.empty() & sq_bit(s)); s = neighbour(s, dir))
+      {
+        if (s == to)
+        {
+          steps.push_back(sq_move(from, to));
+          return true;
+        }
+        if (!king)
+          break;
+      }
+    }
+    return false;
+  }
+  std::vector<sq_move> path;
+  bool found = false;
+  for_each_series(pos, color, [&](const std::vector<sq_move>& series, const Position&)
+    {
+      if (series[0].from != squares[0] || series.back().to != squares.back())
+        return false;
+      // Промежуточные клетки записи должны идти среди полей серии в том же порядке
+      size_t k = 1;
+      for (size_t i = 0; i + 1 < series.size() && k + 1 < squares.size(); ++i)
+      {
+        if (series[i].to == squares[k])
+          ++k;
+      }
+      if (k + 1 != squares.size())
+        return false;
+      if (!found || series.size() + 1 == squares.size())
+        steps = series;
+      found = true;
+      return series.size() + 1 == squares.size();
+    }, path);
+  return found;
+}
+
+// Шаги steps из позиции pos (например, лучшая последовательность поиска), сгруппированные в полные ходы
+inline std::vector<std::vector<sq_move>> split_turns(Position pos, const std::vector<move_pos>& steps)
+{
+  std::vector<std::vector<sq_move>> res;
+  bool series_open = false;
+  for (const auto& turn : steps)
+  {
+    const sq_move step(turn);
+    if (!series_open)
+      res.emplace_back();
+    res.back().push_back(step);
+    pos.apply(step);
+    // Серия взятий продолжается, пока с новой клетки есть взятие
+    move_list list;
+    if (step.beat != NO_SQ)
+      gen_beats_from(pos, step.to, list);
+    series_open = !list.empty();
+  }
+  return res;
+}
+
+// Запись партии в PDN: теги, затем ходы строками до 80 символов и итог
+inline void write_pdn(std::ostream& out, const pdn_game& game)
+{
+  auto write_tag = [&out](const std::string& name, const std::string& value)
+  {
+    out << '[' << name << " \"";
+    for (const char c : value)
+    {
+      if (c == '"' || c == '\\')
+        out << '\\';
+      out << c;
+    }
+    out << "\"]\n";
+  };
+  bool has_result = false, has_type = false, has_fen = false;
+  for (const auto& t : game.tags)
+  {
+    has_result = has_result || t.first == "Result";
+    has_type = has_type || t.first == "GameType";
+    has_fen = has_fen || t.first == "FEN";
+    write_tag(t.first, t.first == "Result" ? game.result : t.second);
+  }
+  if (!has_result)
+    write_tag("Result", game.result);
+  if (!has_type)
+    write_tag("GameType", "25");
+  const Position initial = start_position();
+  if (!has_fen && (game.start_color || game.start.white != initial.white || game.start.black != initial.black ||
+    game.start.kings != initial.kings))
+    write_tag("FEN", to_fen(game.start, game.start_color));
+  out << '\n';
+
+  std::string line;
+  auto put = [&](const std::string& word)
+  {
+    if (!line.empty() && line.size() + 1 + word.size() > 80)
+    {
+      out << line << '\n';
+      line.clear();
+    }
+    line += (line.empty() ? "" : " ") + word;
+  };
+  bool color = game.start_color;
+  int number = 1;
+  for (size_t i = 0; i < game.turns.size(); ++i)
+  {
+    if (!color)
+      put(std::to_string(number) + ".");
+    else if (i == 0)
+      put(std::to_string(number) + "...");
+    put(turn_name(game.turns[i]));
+    if (color)
+      ++number;
+    color = !color;
+  }
+  put(game.result);
+  out << line << "\n\n";
+}
+
+/**
+ * Потоковое чтение партий PDN
+ * Поток читается кусками по PDN_CHUNK байт, в памяти держится только текущая партия, поэтому
+ * размер файла не ограничен. Ходы сразу проверяются по правилам и раскладываются на шаги
+ * Комментарии {}, варианты () и оценки $N пропускаются
+ * Ошибка в партии не прерывает чтение: она записывается в pdn_game::error, ходы до конца партии пропускаются
+ */
+class pdn_reader
+{
+public:
+  explicit pdn_reader(std::istream& in) : in(in), buf(PDN_CHUNK)
+  {
+  }
+
+  // Читает следующую партию в game, false — партий в потоке больше нет
+  bool next(pdn_game& game)
+  {
+    game.clear();
+    if (bytes_read() == 0 && peek() == 0xEF)  // Метка UTF-8 в начале файла
+    {
+      get();
+      get();
+      get();
+    }
+    const unsigned long long begin = bytes_read();
+    Position pos;
+    bool color = false;
+    bool started = false;   // Встретились теги или ходы
+    bool in_moves = false;  // Начался текст ходов
+    bool skip = false;      // После ошибки ходы не разбираются
+    while (true)
+    {
+      const int c = peek();
+      if (c == EOF)
+        return started;
+      if (is_space(c))
+      {
+        skip_spaces();
+        continue;
+      }
+      if (!skip && bytes_read() - begin > PDN_MAX_GAME)
+      {
+        game.error = "game text is longer than " + std::to_string(PDN_MAX_GAME) + " bytes";
+        skip = true;
+      }
+      if (c == '[')
+      {
+        // Теги после ходов — уже следующая партия, записанная без итога
+        if (in_moves)
+          return true;
+        started = true;
+        get();
+        read_tag(game, skip);
+        continue;
+      }
+      if (c == '{')
+      {
+        skip_until('}');
+        continue;
+      }
+      if (c == ';' || c == '%')
+      {
+        skip_until('\n');
+        continue;
+      }
+      if (c == '(')
+      {
+        skip_variation();
+        continue;
+      }
+
+      read_token();
+      if (token == ")" || token == "]")
+        continue;
+      started = true;
+      if (!in_moves)
+      {
+        in_moves = true;
+        pos = game.start;
+        color = game.start_color;
+      }
+      const std::string result = parse_result(token);
+      if (!result.empty())
+      {
+        game.result = result;
+        return true;
+      }
+      if (skip)
+        continue;
+      if (!parse_turn(pos, color))
+      {
+        game.error = "illegal move " + std::to_string(game.turns.size() + 1) + ": " + token;
+        skip = true;
+        continue;
+      }
+      if (!steps.empty())
+      {
+        for (const auto& step : steps)
+          pos.apply(step);
+        game.turns.push_back(steps);
+        color = !color;
+      }
+    }
+  }
+
+  // Сколько байт потока уже разобрано
+  unsigned long long bytes_read() const
+  {
+    return total + at;
+  }
+
+private:
+  int peek()
+  {
+    if (at == len)
+    {
+      total += len;
+      at = 0;
+      in.read(buf.data(), std::streamsize(buf.size()));
+      len = size_t(in.gcount());
+      if (len == 0)
+        return EOF;
+    }
+    return (unsigned char)buf[at];
+  }
+
+  int get()
+  {
+    const int c = peek();
+    if (c != EOF)
+      ++at;
+    return c;
+  }
+
+  void skip_until(const char end)
+  {
+    for (int c = get(); c != EOF && c != end; c = get())
+    {
+    }
+  }
+
+  // Вариант в скобках, возможно вложенный
+  void skip_variation()
+  {
+    int depth = 0;
+    for (int c = get(); c != EOF; c = get())
+    {
+      if (c == '{')
+        skip_until('}');
+      else if (c == '(')
+        ++depth;
+      else if (c == ')' && --depth == 0)
+        return;
+    }
+  }
+
+  static bool is_space(const int c)
+  {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+  }
+
+  static bool is_delimiter(const int c)
+  {
+    return is_space(c) || c == '[' || c == '{' || c == '(' || c == ';';
+  }
+
+  // Пропуск пробелов сразу по буферу
+  void skip_spaces()
+  {
+    while (peek() != EOF)
+    {
+      while (at < len && is_space((unsigned char)buf[at]))
+        ++at;
+      if (at < len)
+        return;
+    }
+  }
+
+  // Слово текста ходов: до пробела или служебного символа, копируется из буфера кусками
+  void read_token()
+  {
+    token.clear();
+    while (peek() != EOF)
+    {
+      const size_t from = at;
+      while (at < len && !is_delimiter((unsigned char)buf[at]))
+        ++at;
+      token.append(buf.data() + from, std::min(at - from, PDN_MAX_TOKEN - std::min(token.size(), PDN_MAX_TOKEN)));
+      if (at < len)
+        break;
+    }
+    if (token.empty())  // Одиночные ')' и ']' вне тегов и вариантов
+      token += char(get());
+  }
+
+  // Тег [Name "value"]; FEN задаёт начальную позицию, GameType должен быть 25
+  void read_tag(pdn_game& game, bool& skip)
+  {
+    std::string name, value;
+    int c = peek();
+    while (c != EOF && is_space(c))
+    {
+      get();
+      c = peek();
+    }
+    while (c != EOF && !is_space(c) && c != '"' && c != ']')
+    {
+      if (name.size() < PDN_MAX_TOKEN)
+        name += char(get());
+      else
+        get();
+      c = peek();
+    }
+    while (c != EOF && c != '"' && c != ']' && c != '\n')
+    {
+      get();
+      c = peek();
+    }
+    if (c == '"')
+    {
+      get();
+      for (c = get(); c != EOF && c != '"' && c != '\n'; c = get())
+      {
+        if (c == '\\')
+          c = get();
+        if (c != EOF && value.size() < PDN_MAX_TOKEN)
+          value += char(c);
+      }
+    }
+    if (c != ']' && c != '\n')
+      skip_until(']');
+    else if (c == ']')
+      get();
+
+    if (name == "FEN" && !skip)
+    {
+      try
+      {
+        game.start = parse_fen(value, game.start_color);
+      }
+      catch (const std::exception& e)
+      {
+        game.error = e.what();
+        skip = true;
+      }
+    }
+    if (name == "GameType" && !skip && value.substr(0, value.find(',')) != "25")
+    {
+      game.error = "unsupported GameType " + value;
+      skip = true;
+    }
+    game.tags.emplace_back(std::move(name), std::move(value));
+  }
+
+  // Итог партии в записи этого формата, пусто — слово не итог
+  static std::string parse_result(const std::string& word)
+  {
+    if (word.empty() || (word[0] != '0' && word[0] != '1' && word[0] != '2' && word[0] != '*'))
+      return "";
+    if (word == "2-0" || word == "1-0")
+      return "2-0";
+    if (word == "0-2" || word == "0-1")
+      return "0-2";
+    if (word == "1-1" || word == "1/2-1/2")
+      return "1-1";
+    if (word == "0-0" || word == "*")
+      return word;
+    return "";
+  }
+
+  /**
+   * Разбирает слово token как ход стороны color, шаги хода — в steps
+   * Номера ходов ("12.", "12..."), оценки ($N) и знаки !? дают пустой steps
+   * false — слово не является допустимым ходом
+   */
+  bool parse_turn(Position& pos, const bool color)
+  {
+    steps.clear();
+    size_t i = 0;
+    while (i < token.size() && token[i] >= '0' && token[i] <= '9')
+      ++i;
+    if (i > 0)
+    {
+      if (i == token.size() || token[i] != '.')
+        return false;  // Числовая запись клеток не поддерживается
+      while (i < token.size() && token[i] == '.')
+        ++i;
+    }
+    size_t end = token.size();
+    while (end > i && (token[end - 1] == '!' || token[end - 1] == '?'))
+      --end;
+    if (i == end || token[i] == '$')
+      return true;
+
+    return parse_turn_squares(token.data() + i, end - i, squares) && match_turn(pos, color, squares, steps) &&
+      !steps.empty();
+  }
+
+  std::istream& in;
+  std::vector<char> buf;
+  size_t at = 0, len = 0;         // Позиция в буфере и число байт в нём
+  unsigned long long total = 0;   // Байт до начала буфера
+  std::string token;
+  std::vector<SQ_T> squares;
+  std::vector<sq_move> steps;
+};
@@ -0,0 +1,794 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "../Models/Position.h"
+#include "Eval.h"
+#include "EvalBatch.h"
+#include "MoveGen.h"
+#include "SearchStats.h"
+#include "Tablebase.h"
+#include "TransTable.h"
+
+// Максимальная глубина, для которой хранятся ходы-убийцы
+const int MAX_PLY = 64;
+
+// Режим O2: запас оценки для отсечения тихих ходов за 1 и 2 хода до горизонта
+const double FUTILITY_MARGIN_1 = 0.05;
+const double FUTILITY_MARGIN_2 = 0.25;
+
+// Режим O2: тихие ходы начиная с этого номера ищутся на ход мельче
+const int LMR_MIN_MOVE = 3;
+const int LMR_MIN_DEPTH = 3;
+
+// Проигрыш по эндшпильным таблицам: чем дальше конец партии, тем лучше для проигрывающего
+const double TB_LOSS_STEP = 1e-6;
+
+/**
+ * Итог одной завершённой итерации поиска для вывода хода поиска
+ * score — оценка корня для стороны, которая ходит: отношение её материала к материалу соперника
+ * после лучшего продолжения, INF и близкие к нему — выигрыш, 0 — проигрыш
+ */
+struct search_info
+{
+  int depth = 0;
+  double score = 0;
+  size_t nodes = 0;           // Узлы всех потоков с начала поиска, с точностью до 1024 узлов на поток
+  double time_ms = 0;
+  std::vector<move_pos> pv;   // Лучшая последовательность шагов, серия взятий — несколько шагов
+
+  double nps() const
+  {
+    return time_ms > 0 ? nodes * 1000.0 / time_ms : 0;
+  }
+};
+
+// Общие для всех потоков данные одного поиска
+struct search_shared
+{
+  TransTable* tt = nullptr;                          // Общая таблица транспозиций
+  std::atomic<bool> stop{ false };                   // Поиск нужно прекратить
+  const std::atomic<bool>* cancel = nullptr;         // Внешний флаг отмены поиска (nullptr — нет)
+  std::chrono::steady_clock::time_point start;       // Время начала поиска
+  int time_limit_ms = 0;                             // Бюджет времени (0 — без ограничения)
+  size_t node_limit = 0;                             // Бюджет узлов всех потоков (0 — без ограничения)
+  std::atomic<size_t> nodes{ 0 };                    // Узлы всех потоков, потоки дописывают их раз в 1024 проверки
+  const Tablebase* tb = nullptr;                     // Эндшпильные таблицы (nullptr — не используются)
+  std::function<void(const search_info&)> on_iteration;  // Вызывается главным потоком после каждой итерации
+};
+
+/**
+ * Поиск лучшего хода в одном потоке без привязки к оценочной функции
+ * Виртуальный вызов один — run на весь поиск, внутри дерева всё уже специализировано
+ */
+class SearchBase
+{
+public:
+  virtual ~SearchBase() = default;
+
+  /**
+   * Итеративное углубление от first_depth до max_depth
+   * После каждой завершённой итерации обновляются best_sequence и depth_reached
+   * Главный поток (is_main) всегда завершает первую итерацию и следит за бюджетом времени
+   */
+  virtual void run(search_shared& shared, const Position& root, const bool color,
+    const int first_depth, const int max_depth, const bool is_main) = 0;
+
+  // Последовательность лучших ходов последней завершённой итерации
+  std::vector<move_pos> best_sequence;
+
+  // Глубина последней завершённой итерации (-1 — ни одной) и оценка её корня
+  int depth_reached = -1;
+  double root_score = 0;
+
+  // Счётчики последнего поиска этого потока
+  search_stats stats;
+};
+
+/**
+ * Поиск лучшего хода в одном потоке с оценочной функцией Eval (Eval.h)
+ * Все изменяемые во время поиска данные принадлежат объекту, поэтому несколько
+ * объектов могут искать одновременно, обмениваясь результатами через таблицу транспозиций
+ */
+template <class Eval>
+class Search : public SearchBase
+{
+public:
+  Search(const std::string& optimization, const bool quiescence, const unsigned seed)
+    : rand_eng(seed), pruning(optimization != "O0"), selective(optimization == "O2"), quiescence(quiescence)
+  {
+  }
+
+  void run(search_shared& shared, const Position& root, const bool color,
+    const int first_depth, const int max_depth, const bool is_main) override
+  {
+    sh = &shared;
+    main_thread = is_main;
+    stopped = false;
+    checks = 0;
+    nodes_reported = 0;
+    stats = search_stats();
+    depth_reached = -1;
+    root_score = 0;
+    best_sequence.clear();
+
+    // Ходы-убийцы относятся к прошлой позиции, история ослабляется вдвое
+    for (auto& k : killers)
+      k[0] = k[1] = sq_move(NO_SQ, NO_SQ);
+    for (auto& h : history)
+    {
+      for (auto& from : h)
+      {
+        for (auto& v : from)
+          v /= 2;
+      }
+    }
+
+    Position pos = root;
+    for (depth_limit = first_depth; depth_limit <= max_depth; ++depth_limit)
+    {
+      can_stop = !is_main || depth_limit != first_depth;
+      next_best_state.clear();
+      next_move.clear();
+      const double score = find_first_best_turn(pos, color, NO_SQ, 0);
+      if (stopped)
+        break;
+
+      // Собираем последовательность лучших ходов
+      best_sequence.clear();
+      int current_state = 0;
+      while (current_state != -1 && next_move[current_state].from != NO_SQ)
+      {
+        best_sequence.push_back(next_move[current_state].to_move_pos());
+        current_state = next_best_state[current_state];
+      }
+      depth_reached = depth_limit;
+      root_score = score;
+      if (is_main && shared.on_iteration)
+      {
+        report_nodes();
+        search_info info;
+        info.depth = depth_reached;
+        info.score = root_score;
+        info.nodes = shared.nodes.load(std::memory_order_relaxed);
+        info.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shared.start).count();
+        info.pv = best_sequence;
+        extend_pv(root, color, info.pv);
+        shared.on_iteration(info);
+      }
+    }
+    stats.depth = depth_reached;
+  }
+
+private:
+  // Проверка остановки раз в 1024 узла, после остановки поиск сворачивается
+  bool is_stopped()
+  {
+    if ((++checks & 1023) || stopped)
+      return stopped;
+    report_nodes();
+    // Внешняя отмена прерывает и первую итерацию главного потока, её результат тогда не нужен
+    if (sh->cancel && sh->cancel->load(std::memory_order_relaxed))
+      stopped = true;
+    else if (!can_stop)
+      return false;
+    else if (sh->stop.load(std::memory_order_relaxed))
+      stopped = true;
+    else if (main_thread && sh->time_limit_ms > 0 &&
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sh->start).count() >= sh->time_limit_ms)
+    {
+      stopped = true;
+      sh->stop.store(true, std::memory_order_relaxed);
+    }
+    else if (sh->node_limit && sh->nodes.load(std::memory_order_relaxed) >= sh->node_limit)
+    {
+      stopped = true;
+      sh->stop.store(true, std::memory_order_relaxed);
+    }
+    return stopped;
+  }
+
+  /**
+   * Продолжает лучший ход корня ходами из таблицы транспозиций, не дальше глубины итерации
+   * Таблица хранит только первый шаг хода, поэтому продолжение обрывается на неоднозначной серии взятий
+   */
+  void extend_pv(const Position& root, const bool color, std::vector<move_pos>& pv)
+  {
+    Position pos = root;
+    for (const auto& turn : pv)
+      pos.apply(sq_move(turn));
+    bool side = !color;
+    for (int turn = 1; turn <= depth_limit; ++turn)
+    {
+      tt_entry e;
+      if (!sh->tt->probe(position_key(pos, side, color), e))
+        return;
+      move_list list;
+      gen_moves(pos, side, list);
+      const sq_move* step = nullptr;
+      for (const auto& m : list)
+      {
+        if (m.from == e.from && m.to == e.to)
+          step = &m;
+      }
+      if (!step)
+        return;
+      std::vector<move_pos> series(1, step->to_move_pos());
+      pos.apply(*step);
+      for (SQ_T s = step->beat != NO_SQ ? step->to : NO_SQ; s != NO_SQ;)
+      {
+        gen_beats_from(pos, s, list);
+        if (list.size > 1)
+          return;
+        if (list.empty())
+          break;
+        series.push_back(list.begin()->to_move_pos());
+        pos.apply(*list.begin());
+        s = list.begin()->to;
+      }
+      pv.insert(pv.end(), series.begin(), series.end());
+      side = !side;
+    }
+  }
+
+  // Дописывает в общий счётчик узлы, пройденные с прошлого вызова
+  void report_nodes()
+  {
+    sh->nodes.fetch_add(stats.nodes - nodes_reported, std::memory_order_relaxed);
+    nodes_reported = stats.nodes;
+  }
+
+  // Ключ позиции в таблице транспозиций: расстановка, очередь хода и цвет, за который ведётся оценка
+  static uint64_t position_key(const Position& pos, const bool color, const bool first_bot_color)
+  {
+    return pos.hash ^ (color ? ZOBRIST.side : 0) ^ (first_bot_color ? ZOBRIST.bot : 0);
+  }
+
+  /**
+   * Упорядочивает ходы для альфа-бета отсечения:
+   * ход из таблицы транспозиций, взятия (сначала дамок), превращения в дамку,
+   * два хода-убийцы этой глубины и далее по таблице истории
+   * Во вспомогательных потоках равные ходы перемешиваются, чтобы потоки расходились
+   */
+  void order_moves(move_list& list, const Position& pos, const bool color, const size_t depth,
+    const sq_move& hash_move)
+  {
+    if (!main_thread)
+      std::shuffle(list.begin(), list.end(), rand_eng);
+    int scores[MAX_MOVES];
+    const bool have_killers = depth < MAX_PLY;
+    for (int i = 0; i < list.size; ++i)
+    {
+      const sq_move& turn = list[i];
+      int score;
+      if (turn == hash_move)
+        score = 1 << 30;
+      else if (turn.beat != NO_SQ)
+        score = (1 << 28) + ((pos.kings & sq_bit(turn.beat)) ? 2 : 0) + !(pos.kings & sq_bit(turn.from));
+      else if (is_promotion(pos, turn))
+        score = 1 << 27;
+      else if (have_killers && turn == killers[depth][0])
+        score = (1 << 26) + 1;
+      else if (have_killers && turn == killers[depth][1])
+        score = 1 << 26;
+      else
+        score = history[color][turn.from][turn.to];
+      scores[i] = score;
+    }
+    // Сортировка вставками: списки короткие, порядок равных ходов сохраняется
+    for (int i = 1; i < list.size; ++i)
+    {
+      const sq_move turn = list[i];
+      const int score = scores[i];
+      int j = i - 1;
+      for (; j >= 0 && scores[j] < score; --j)
+      {
+        list[j + 1] = list[j];
+        scores[j + 1] = scores[j];
+      }
+      list[j + 1] = turn;
+      scores[j + 1] = score;
+    }
+  }
+
+  // Запоминает тихий ход, вызвавший отсечение
+  void remember_cutoff(const sq_move& turn, const bool color, const size_t depth, const int remaining)
+  {
+    if (turn.beat != NO_SQ)
+      return;
+    if (depth < MAX_PLY && turn != killers[depth][0])
+    {
+      killers[depth][1] = killers[depth][0];
+      killers[depth][0] = turn;
+    }
+    int& h = history[color][turn.from][turn.to];
+    h = std::min(h + remaining * remaining, 1 << 25);
+  }
+
+  // Ставит ход из таблицы транспозиций первым в списке
+  static void put_first(move_list& list, const sq_move& hash_move)
+  {
+    if (hash_move.from == NO_SQ)
+      return;
+    for (auto& turn : list)
+    {
+      if (turn == hash_move)
+      {
+        std::swap(turn, list[0]);
+        return;
+      }
+    }
+  }
+
+  // Оценивает позицию для бота, оценка встраивается на этапе компиляции
+  static double calc_score(const Position& pos, const bool first_bot_color)
+  {
+    return Eval::score(pos, first_bot_color);
+  }
+
+  /**
+   * Оценка позиции из эндшпильных таблиц для бота
+   * Быстрый выигрыш лучше медленного, а долгий проигрыш лучше быстрого,
+   * поэтому выигрывающая сторона доводит партию до конца, а не ходит по кругу
+   */
+  static double tb_score(const tb_entry& e, const bool bot_to_move)
+  {
+    if (e.result == TbResult::DRAW)
+      return 1;
+    const bool bot_wins = (e.result == TbResult::WIN) == bot_to_move;
+    return bot_wins ? INF - e.distance : e.distance * TB_LOSS_STEP;
+  }
+
+  /**
+  * Находит первый лучший ход и строит дерево возможных продолжений
+  * Рекурсивно оценивает все возможные варианты
+  */
+  double find_first_best_turn(Position& pos, const bool color,
+    const SQ_T s, size_t state,
+    double alpha = -1)
+  {
+    // Инициализация нового состояния
+    next_best_state.push_back(-1);
+    next_move.emplace_back(NO_SQ, NO_SQ);
+
+    double best_score = -1;
+    bool is_initial_state = (state == 0);
+    ++stats.nodes;
+    stats.extensions += !is_initial_state;
+
+    // Находим все возможные ходы для текущей позиции
+    move_list current_turns;
+    uint64_t key = 0;
+    if (is_initial_state)
+    {
+      gen_moves(pos, color, current_turns);
+      std::shuffle(current_turns.begin(), current_turns.end(), rand_eng);
+      // Лучший ход из прошлых поисков проверяем первым
+      key = position_key(pos, color, color);
+      tt_entry e;
+      stats.hash_probes += !sh->tt->empty();
+      if (sh->tt->probe(key, e))
+      {
+        ++stats.hash_hits;
+        put_first(current_turns, sq_move(e.from, e.to));
+      }
+    }
+    else
+      gen_beats_from(pos, s, current_turns);
+
+    bool current_has_beats = current_turns.have_beats;
+
+    // Если нет обязательных взятий и это не начальное состояние
+    if (!current_has_beats && !is_initial_state)
+    {
+      return find_best_turns_rec(pos, !color, 0, alpha);
+    }
+
+    // Перебираем все возможные ходы
+    for (auto& turn : current_turns)
+    {
+      size_t next_state = next_move.size();
+      double score;
+      undo_info undo;
+      pos.make(turn, undo);
+
+      if (current_has_beats)
+      {
+        // Продолжаем серию взятий
+        score = find_first_best_turn(pos, color, turn.to, next_state, best_score);
+      }
+      else if (selective && &turn != current_turns.begin())
+      {
+        // O2: сначала проверяем нулевым окном, лучше ли ход уже найденного
+        score = find_best_turns_rec(pos, !color, 0, best_score, std::nextafter(best_score, INF + 2));
+        if (score > best_score && !stopped)
+          score = find_best_turns_rec(pos, !color, 0, best_score);
+      }
+      else
+      {
+        // Оцениваем позицию после хода
+        score = find_best_turns_rec(pos, !color, 0, best_score);
+      }
+      pos.unmake(turn, undo);
+      if (stopped)
+        return best_score;
+
+      // Обновляем лучший ход, если нашли лучше
+      if (score > best_score)
+      {
+        best_score = score;
+        next_best_state[state] = current_has_beats ? static_cast<int>(next_state) : -1;
+        next_move[state] = turn;
+      }
+    }
+
+    // Оценка корня точная: она соответствует глубине на один ход больше текущей
+    if (is_initial_state && !current_turns.empty())
+      sh->tt->store(key, depth_limit + 1, Bound::EXACT, best_score, next_move[state]);
+
+    return best_score;
+  }
+
+  /**
+   * Рекурсивная функция поиска с альфа-бета отсечением
+   * Оценивает позицию на заданной глубине
+   * reduction — на сколько ходов сокращён поиск по этой ветке (режим O2)
+   */
+  double find_best_turns_rec(Position& pos, const bool color,
+    const size_t depth, double alpha, double beta = INF + 1,
+    const SQ_T s = NO_SQ, const int reduction = 0)
+  {
+    ++stats.nodes;
+    stats.extensions += (s != NO_SQ);
+
+    // Позиция из эндшпильных таблиц оценивается точно (в середине серии взятий позиция не завершена)
+    if (s == NO_SQ && sh->tb && popcount(pos.white | pos.black) <= sh->tb->max_pieces())
+    {
+      tb_entry e;
+      if (sh->tb->probe(pos, color, e))
+      {
+        ++stats.tb_hits;
+        return tb_score(e, depth % 2 == 1);
+      }
+    }
+
+    // Базовый случай - достигнута максимальная глубина
+    const int remaining = depth_limit - int(depth) - reduction;
+    if (remaining <= 0)
+    {
+      if (quiescence)
+        return quiesce(pos, color, depth, alpha, beta);
+      ++stats.evaluations;
+      return calc_score(pos, (depth % 2 == color));
+    }
+
+    if (is_stopped())
+      return 0;
+
+    // Проверяем таблицу транспозиций (в середине серии взятий позиция не завершена)
+    const double alpha0 = alpha, beta0 = beta;
+    uint64_t key = 0;
+    sq_move hash_move(NO_SQ, NO_SQ);
+    if (s == NO_SQ)
+    {
+      key = position_key(pos, color, depth % 2 == color);
+      tt_entry e;
+      stats.hash_probes += !sh->tt->empty();
+      if (sh->tt->probe(key, e))
+      {
+        ++stats.hash_hits;
+        hash_move = sq_move(e.from, e.to);
+        if (e.depth >= remaining &&
+          (e.bound == Bound::EXACT || (e.bound == Bound::LOWER && e.score >= beta) ||
+            (e.bound == Bound::UPPER && e.score <= alpha)))
+          return e.score;
+      }
+    }
+
+    // Находим возможные ходы: всей стороны или продолжения серии взятий
+    move_list current_turns;
+    if (s != NO_SQ)
+      gen_beats_from(pos, s, current_turns);
+    else
+    {
+      gen_moves(pos, color, current_turns);
+      order_moves(current_turns, pos, color, depth, hash_move);
+    }
+
+    bool current_has_beats = current_turns.have_beats;
+
+    // Обработка окончания серии взятий
+    if (!current_has_beats && s != NO_SQ)
+    {
+      return find_best_turns_rec(pos, !color, depth + 1, alpha, beta, NO_SQ, reduction);
+    }
+
+    // Если нет возможных ходов
+    if (current_turns.empty())
+      return (depth % 2 ? 0 : INF);
+
+    double min_score = INF + 1;
+    double max_score = -1;
+    sq_move best_move = current_turns[0];
+    ++stats.inner_nodes;
+
+    // O2: у горизонта тихий ход почти не меняет оценку, и если даже с запасом
+    // она не выходит за окно, такие ходы не перебираются
+    const bool quiet_node = !current_has_beats && s == NO_SQ;
+    double futility_score = 0;
+    bool futile = false;
+    if (selective && quiet_node && remaining <= 2)
+    {
+      const double margin = (remaining == 1) ? FUTILITY_MARGIN_1 : FUTILITY_MARGIN_2;
+      ++stats.evaluations;
+      const double eval = calc_score(pos, (depth % 2 == color));
+      futility_score = (depth % 2) ? eval * (1 + margin) : eval * (1 - margin);
+      futile = (depth % 2) ? futility_score <= alpha : futility_score >= beta;
+    }
+
+    // У горизонта все тихие ходы ведут в листья, их позиции оцениваются одним блоком
+    // Листья из эндшпильных таблиц и ходы, отброшенные отсечением у горизонта, так не оцениваются
+    const bool frontier = quiet_node && remaining == 1 && !futile &&
+      !(sh->tb && popcount(pos.white | pos.black) <= sh->tb->max_pieces());
+    if (frontier)
+      evaluate_leaves(pos, current_turns, color, depth % 2 == color);
+
+    // Перебираем все возможные ходы
+    int move_num = 0;
+    for (auto& turn : current_turns)
+    {
+      double score = 0.0;
+      const bool is_first = (move_num++ == 0);
+      const bool tactical = quiet_node && (turn == hash_move || is_promotion(pos, turn) ||
+        (depth < MAX_PLY && (turn == killers[depth][0] || turn == killers[depth][1])));
+
+      if (futile && !is_first && !tactical)
+      {
+        min_score = std::min(min_score, futility_score);
+        max_score = std::max(max_score, futility_score);
+        continue;
+      }
+
+      if (frontier && leaf_quiet[move_num - 1])
+      {
+        // Лист уже оценён вместе с остальными
+        ++stats.nodes;
+        score = leaf_scores[move_num - 1];
+      }
+      else
+      {
+        undo_info undo;
+        pos.make(turn, undo);
+
+        if (!quiet_node)
+        {
+          // Продолжаем серию взятий тем же цветом
+          score = find_best_turns_rec(pos, color, depth, alpha, beta, turn.to, reduction);
+        }
+        else if (!selective || is_first)
+        {
+          // Обычный ход, меняем цвет
+          score = find_best_turns_rec(pos, !color, depth + 1, alpha, beta, NO_SQ, reduction);
+        }
+        else
+        {
+          // O2: поздние тихие ходы ищем мельче и нулевым окном,
+          // при улучшении оценки — повторно на полную глубину и с полным окном
+          const double null_alpha = (depth % 2) ? alpha : std::nextafter(beta, -2.0);
+          const double null_beta = (depth % 2) ? std::nextafter(alpha, INF + 2) : beta;
+          const int r = (!tactical && move_num > LMR_MIN_MOVE && remaining >= LMR_MIN_DEPTH) ? 1 : 0;
+          score = find_best_turns_rec(pos, !color, depth + 1, null_alpha, null_beta, NO_SQ, reduction + r);
+          if (r && !stopped && (depth % 2 ? score > alpha : score < beta))
+            score = find_best_turns_rec(pos, !color, depth + 1, null_alpha, null_beta, NO_SQ, reduction);
+          if (!stopped && (depth % 2 ? score > alpha : score < beta))
+            score = find_best_turns_rec(pos, !color, depth + 1, alpha, beta, NO_SQ, reduction);
+        }
+        pos.unmake(turn, undo);
+        if (stopped)
+          return 0;
+      }
+
+      // Обновляем минимальную и максимальную оценки
+      if (depth % 2 ? score > max_score : score < min_score)
+        best_move = turn;
+      min_score = std::min(min_score, score);
+      max_score = std::max(max_score, score);
+
+      // Альфа-бета отсечение
+      if (depth % 2)
+        alpha = std::max(alpha, max_score);
+      else
+        beta = std::min(beta, min_score);
+
+      if (pruning && alpha >= beta)
+      {
+        ++stats.cutoffs;
+        stats.first_move_cutoffs += is_first;
+        // Сохраняется граница окна: возвращаемое значение сдвинуто и не является точной границей
+        if (s == NO_SQ)
+        {
+          remember_cutoff(turn, color, depth, remaining);
+          sh->tt->store(key, remaining, depth % 2 ? Bound::LOWER : Bound::UPPER, depth % 2 ? beta0 : alpha0, best_move);
+        }
+        return (depth % 2 ? max_score + 1 : min_score - 1);
+      }
+    }
+
+    double result = (depth % 2 ? max_score : min_score);
+    if (s == NO_SQ)
+    {
+      if (result <= alpha0)
+        sh->tt->store(key, remaining, Bound::UPPER, alpha0, best_move);
+      else if (result >= beta0)
+        sh->tt->store(key, remaining, Bound::LOWER, beta0, best_move);
+      else
+        sh->tt->store(key, remaining, Bound::EXACT, result, best_move);
+    }
+    return result;
+  }
+
+  /**
+   * Оценивает блоком позиции после каждого тихого хода списка, результат — в leaf_scores
+   * С поиском по взятиям лист, где у соперника есть взятие, оценкой не заканчивается (leaf_quiet — false)
+   */
+  void evaluate_leaves(const Position& pos, const move_list& list, const bool color, const bool first_bot_color)
+  {
+    for (int i = 0; i < list.size; ++i)
+    {
+      const uint32_t from = sq_bit(list[i].from), to = sq_bit(list[i].to);
+      uint32_t white = pos.white, black = pos.black, kings = pos.kings;
+      (color ? black : white) ^= from | to;
+      if (kings & from)
+        kings ^= from | to;
+      else if (to & (color ? BOTTOM_ROW : TOP_ROW))
+        kings |= to;
+      leaf_white[i] = white;
+      leaf_black[i] = black;
+      leaf_kings[i] = kings;
+      leaf_quiet[i] = true;
+      if (quiescence)
+      {
+        Position leaf;
+        leaf.white = white;
+        leaf.black = black;
+        leaf.kings = kings;
+        leaf_quiet[i] = !has_beats(leaf, !color);
+      }
+    }
+    eval_batch<Eval>(leaf_white, leaf_black, leaf_kings, size_t(list.size), first_bot_color, leaf_scores);
+    stats.evaluations += size_t(list.size);
+  }
+
+  /**
+   * Поиск по взятиям за горизонтом: взятие обязательно, поэтому позиция, где у стороны есть взятие,
+   * не оценивается, а доигрываются все серии взятий. Позиция без взятий оценивается сразу (stand pat):
+   * в отличие от шахмат, оценку позиции со взятием нельзя взять границей — отказаться от взятия нельзя
+   * Серии конечны: каждое взятие убирает фигуру. Отсечение по окну — как в find_best_turns_rec
+   */
+  double quiesce(Position& pos, const bool color, const size_t depth, double alpha, double beta,
+    const SQ_T s = NO_SQ)
+  {
+    ++stats.nodes;
+    ++stats.quiescence_nodes;
+    stats.extensions += (s != NO_SQ);
+    if (s == NO_SQ)
+    {
+      if (sh->tb && popcount(pos.white | pos.black) <= sh->tb->max_pieces())
+      {
+        tb_entry e;
+        if (sh->tb->probe(pos, color, e))
+        {
+          ++stats.tb_hits;
+          return tb_score(e, depth % 2 == 1);
+        }
+      }
+      if (!has_beats(pos, color))
+      {
+        ++stats.evaluations;
+        return calc_score(pos, (depth % 2 == color));
+      }
+    }
+
+    move_list current_turns;
+    if (s != NO_SQ)
+      gen_beats_from(pos, s, current_turns);
+    else
+      gen_moves(pos, color, current_turns);
+
+    // Серия взятий закончилась, ходит соперник
+    if (current_turns.empty())
+      return quiesce(pos, !color, depth + 1, alpha, beta);
+
+    double best = (depth % 2) ? -1 : INF + 1;
+    for (const auto& turn : current_turns)
+    {
+      undo_info undo;
+      pos.make(turn, undo);
+      const double score = quiesce(pos, color, depth, alpha, beta, turn.to);
+      pos.unmake(turn, undo);
+      if (depth % 2)
+      {
+        best = std::max(best, score);
+        alpha = std::max(alpha, best);
+      }
+      else
+      {
+        best = std::min(best, score);
+        beta = std::min(beta, best);
+      }
+      if (pruning && alpha >= beta)
+        break;
+    }
+    return best;
+  }
+
+  // Тихий ход простой шашки на последнюю горизонталь
+  static bool is_promotion(const Position& pos, const sq_move& turn)
+  {
+    return !(pos.kings & sq_bit(turn.from)) &&
+      (sq_bit(turn.to) & ((pos.white & sq_bit(turn.from)) ? TOP_ROW : BOTTOM_ROW));
+  }
+
+  // Генератор случайных чисел
+  std::default_random_engine rand_eng;
+
+  // Альфа-бета отсечение включено (O1, O2)
+  bool pruning;
+
+  // Выборочный поиск: сокращения, отсечение у горизонта и нулевое окно (O2)
+  bool selective;
+
+  // Поиск по взятиям за горизонтом (Quiescence)
+  bool quiescence;
+
+  // Ходы, ведущие к лучшему результату
+  std::vector<sq_move> next_move;
+
+  // Переходы между состояниями
+  std::vector<int> next_best_state;
+
+  // Два последних тихих хода, вызвавших отсечение, на каждой глубине
+  sq_move killers[MAX_PLY][2];
+
+  // Таблица истории: насколько часто ход (цвет, откуда, куда) вызывал отсечение
+  int history[2][32][32] = {};
+
+  // Позиции и оценки листьев узла у горизонта: такие узлы не вложены друг в друга, хватает одного набора
+  uint32_t leaf_white[MAX_MOVES], leaf_black[MAX_MOVES], leaf_kings[MAX_MOVES];
+  double leaf_scores[MAX_MOVES];
+  bool leaf_quiet[MAX_MOVES];
+
+  // Данные текущего поиска
+  search_shared* sh = nullptr;
+
+  // Глубина текущей итерации поиска
+  int depth_limit = 0;
+
+  // Главный поток, можно ли прервать текущую итерацию и прервана ли она
+  bool main_thread = true;
+  bool can_stop = false;
+  bool stopped = false;
+
+  // Счётчик вызовов is_stopped: время и флаги проверяются раз в 1024 вызова
+  size_t checks = 0;
+
+  // Узлы этого потока, уже добавленные в search_shared::nodes
+  size_t nodes_reported = 0;
+};
+
+// Поиск с оценочной функцией по её имени из настроек (BotScoringType), неизвестное имя — только количество
+inline std::unique_ptr<SearchBase> make_search(const std::string& scoring_mode, const std::string& optimization,
+  const bool quiescence, const unsigned seed)
+{
+  if (scoring_mode == "NumberAndPotential")
+    return std::unique_ptr<SearchBase>(new Search<NumberAndPotential>(optimization, quiescence, seed));
+  return std::unique_ptr<SearchBase>(new Search<NumberOnly>(optimization, quiescence, seed));
+}
@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <stddef.h>
+#include <sstream>
+#include <string>
+
+/**
+ * Счётчики одного хода ИИ, суммарно по всем потокам поиска
+ * Возвращаются Logic::last_stats() после find_best_turns и пишутся построчно в JSON
+ * для сравнения эффективности поиска между сборками и типами позиций
+ */
+struct search_stats
+{
+  std::string source = "search";  // Откуда ход: search — поиск, ponder — обдумывание, book — дебютная книга
+  int depth = -1;                 // Глубина последней завершённой итерации главного потока
+  double time_ms = 0;             // Время поиска, давшего ход
+  size_t nodes = 0;               // Все узлы дерева, включая листья
+  size_t evaluations = 0;         // Вызовы оценочной функции (листья и отсечение у горизонта)
+  size_t inner_nodes = 0;         // Узлы с перебором ходов
+  size_t cutoffs = 0;             // Альфа-бета отсечения
+  size_t first_move_cutoffs = 0;  // Отсечения на первом же ходу
+  size_t extensions = 0;          // Продолжения серий взятий, которые не уменьшают глубину
+  size_t quiescence_nodes = 0;    // Узлы поиска по взятиям за горизонтом (входят в nodes)
+  size_t hash_probes = 0;         // Обращения к таблице транспозиций
+  size_t hash_hits = 0;           // Найденные в ней позиции
+  size_t tb_hits = 0;             // Позиции, оценённые по эндшпильным таблицам
+
+  // Узлов в секунду
+  double nps() const
+  {
+    return time_ms > 0 ? nodes * 1000.0 / time_ms : 0;
+  }
+
+  double cutoff_rate() const
+  {
+    return inner_nodes ? double(cutoffs) / inner_nodes : 0;
+  }
+
+  double first_move_cutoff_rate() const
+  {
+    return cutoffs ? double(first_move_cutoffs) / cutoffs : 0;
+  }
+
+  double hash_hit_rate() const
+  {
+    return hash_probes ? double(hash_hits) / hash_probes : 0;
+  }
+
+  // Поля объекта JSON без фигурных скобок, чтобы вызывающий мог дописать свои (позицию, уровень, ...)
+  std::string json_fields() const
+  {
+    std::ostringstream out;
+    out << "\"source\":\"" << source << "\",\"depth\":" << depth << ",\"time_ms\":" << time_ms
+      << ",\"nodes\":" << nodes << ",\"nps\":" << size_t(nps()) << ",\"evaluations\":" << evaluations
+      << ",\"inner_nodes\":" << inner_nodes << ",\"cutoffs\":" << cutoffs
+      << ",\"first_move_cutoffs\":" << first_move_cutoffs << ",\"extensions\":" << extensions
+      << ",\"quiescence_nodes\":" << quiescence_nodes
+      << ",\"hash_probes\":" << hash_probes << ",\"hash_hits\":" << hash_hits << ",\"tb_hits\":" << tb_hits;
+    return out.str();
+  }
+
+  search_stats& operator+=(const search_stats& other)
+  {
+    nodes += other.nodes;
+    evaluations += other.evaluations;
+    inner_nodes += other.inner_nodes;
+    cutoffs += other.cutoffs;
+    first_move_cutoffs += other.first_move_cutoffs;
+    extensions += other.extensions;
+    quiescence_nodes += other.quiescence_nodes;
+    hash_probes += other.hash_probes;
+    hash_hits += other.hash_hits;
+    tb_hits += other.tb_hits;
+    return *this;
+  }
+};
@@ -0,0 +1,312 @@
+﻿#pragma once
+#include <stdint.h>
+#include <cstring>
+#include <string>
+
+#include "../Models/Position.h"
+#include "MappedFile.h"
+
+/**
+ * Эндшпильные таблицы: для каждой позиции с небольшим числом фигур — выигрыш, проигрыш или ничья
+ * и число ходов до конца партии (серия взятий — один ход)
+ * Таблицы строит Tools/tbgen.cpp ретроградным анализом, в игре файл только читается через mmap,
+ * поэтому несколько процессов с движком держат в памяти одну копию
+ *
+ * Позиции хранятся только с ходом белых: позиция с ходом чёрных поворачивается на 180 градусов
+ * со сменой цветов. Позиции разбиты на срезы по материалу (простые и дамки каждой стороны),
+ * внутри среза номер позиции вычисляется по сочетаниям клеток
+ */
+
+// Наибольшее число фигур, которое поддерживает формат файла
+const int TB_MAX_PIECES = 8;
+
+// Результат для стороны, которая ходит
+enum class TbResult : uint8_t
+{
+  DRAW,
+  WIN,
+  LOSS
+};
+
+struct tb_entry
+{
+  TbResult result = TbResult::DRAW;
+  int distance = 0;  // Число ходов до конца партии при лучшей игре обеих сторон
+};
+
+// Один байт на позицию: 0 — ничья, 1..127 — выигрыш за столько ходов, 128..255 — проигрыш за (значение - 128) ходов
+inline uint8_t tb_encode(const tb_entry& e)
+{
+  const int d = e.distance < 127 ? e.distance : 127;
+  if (e.result == TbResult::WIN)
+    return uint8_t(d < 1 ? 1 : d);
+  if (e.result == TbResult::LOSS)
+    return uint8_t(128 + d);
+  return 0;
+}
+
+inline tb_entry tb_decode(const uint8_t v)
+{
+  tb_entry e;
+  if (v == 0)
+    return e;
+  e.result = (v < 128) ? TbResult::WIN : TbResult::LOSS;
+  e.distance = (v < 128) ? v : v - 128;
+  return e;
+}
+
+// Биномиальные коэффициенты C(n, k) для n <= 32
+struct binomial_table
+{
+  uint64_t c[33][33];
+};
+
+constexpr binomial_table make_binomial_table()
+{
+  binomial_table t{};
+  for (int n = 0; n <= 32; ++n)
+  {
+    t.c[n][0] = 1;
+    for (int k = 1; k <= n; ++k)
+      t.c[n][k] = t.c[n - 1][k - 1] + (k <= n - 1 ? t.c[n - 1][k] : 0);
+  }
+  return t;
+}
+
+constexpr binomial_table BINOMIAL = make_binomial_table();
+
+// Материал среза: простые и дамки стороны, которая ходит (w), и соперника (b)
+struct tb_material
+{
+  int wm = 0, wk = 0, bm = 0, bk = 0;
+
+  int total() const
+  {
+    return wm + wk + bm + bk;
+  }
+
+  // Тот же материал с точки зрения соперника
+  tb_material flipped() const
+  {
+    return { bm, bk, wm, wk };
+  }
+
+  bool operator==(const tb_material& other) const
+  {
+    return wm == other.wm && wk == other.wk && bm == other.bm && bk == other.bk;
+  }
+};
+
+inline tb_material material_of(const Position& pos)
+{
+  return { popcount(pos.white & ~pos.kings), popcount(pos.white & pos.kings),
+    popcount(pos.black & ~pos.kings), popcount(pos.black & pos.kings) };
+}
+
+// Поворот доски на 180 градусов со сменой цветов: ход чёрных становится ходом белых
+inline uint32_t reverse_bits(uint32_t b)
+{
+  b = ((b >> 1) & 0x55555555u) | ((b & 0x55555555u) << 1);
+  b = ((b >> 2) & 0x33333333u) | ((b & 0x33333333u) << 2);
+  b = ((b >> 4) & 0x0F0F0F0Fu) | ((b & 0x0F0F0F0Fu) << 4);
+  b = ((b >> 8) & 0x00FF00FFu) | ((b & 0x00FF00FFu) << 8);
+  return (b >> 16) | (b << 16);
+}
+
+inline Position flip_colors(const Position& pos)
+{
+  Position res;
+  res.white = reverse_bits(pos.black);
+  res.black = reverse_bits(pos.white);
+  res.kings = reverse_bits(pos.kings);
+  res.update_hash();
+  return res;
+}
+
+// Номер множества клеток среди всех сочетаний того же размера (колексикографический порядок)
+inline uint64_t rank_set(uint32_t set)
+{
+  uint64_t r = 0;
+  for (int i = 1; set; ++i)
+    r += BINOMIAL.c[pop_lsb(set)][i];
+  return r;
+}
+
+// Множество из k клеток среди n по номеру
+inline uint32_t unrank_set(uint64_t r, const int k, const int n)
+{
+  uint32_t set = 0;
+  int c = n - 1;
+  for (int i = k; i >= 1; --i)
+  {
+    while (BINOMIAL.c[c][i] > r)
+      --c;
+    set |= sq_bit(SQ_T(c));
+    r -= BINOMIAL.c[c][i];
+    --c;
+  }
+  return set;
+}
+
+// Сжимает клетки set до номеров среди свободных клеток free
+inline uint32_t compress_to(const uint32_t set, const uint32_t free)
+{
+  uint32_t res = 0;
+  for (uint32_t b = set; b;)
+  {
+    const SQ_T s = pop_lsb(b);
+    res |= sq_bit(SQ_T(popcount(free & (sq_bit(s) - 1))));
+  }
+  return res;
+}
+
+// Обратное к compress_to: номера среди свободных клеток в клетки доски
+inline uint32_t expand_from(uint32_t set, const uint32_t free)
+{
+  uint32_t res = 0;
+  uint32_t f = free;
+  for (int i = 0; set; ++i)
+  {
+    const SQ_T s = pop_lsb(f);
+    if (set & sq_bit(SQ_T(i)))
+    {
+      res |= sq_bit(s);
+      set &= ~sq_bit(SQ_T(i));
+    }
+  }
+  return res;
+}
+
+/**
+ * Число позиций в срезе
+ * Белые простые стоят на 28 клетках без строки 0, чёрные — на 28 клетках без строки 7,
+ * дамки — на клетках, свободных от простых
+ */
+inline uint64_t tb_slice_size(const tb_material& m)
+{
+  const int free = 32 - m.wm - m.bm;
+  return BINOMIAL.c[28][m.wm] * BINOMIAL.c[28][m.bm] * BINOMIAL.c[free][m.wk] * BINOMIAL.c[free - m.wk][m.bk];
+}
+
+// Номер позиции с ходом белых внутри её среза
+inline uint64_t tb_index(const Position& pos, const tb_material& m)
+{
+  const uint32_t w_men = pos.white & ~pos.kings, b_men = pos.black & ~pos.kings;
+  const uint32_t w_kings = pos.white & pos.kings, b_kings = pos.black & pos.kings;
+  const uint32_t free1 = ~(w_men | b_men), free2 = free1 & ~w_kings;
+  const int n1 = 32 - m.wm - m.bm;
+  uint64_t index = rank_set(w_men >> 4);
+  index = index * BINOMIAL.c[28][m.bm] + rank_set(b_men);
+  index = index * BINOMIAL.c[n1][m.wk] + rank_set(compress_to(w_kings, free1));
+  index = index * BINOMIAL.c[n1 - m.wk][m.bk] + rank_set(compress_to(b_kings, free2));
+  return index;
+}
+
+// Позиция по номеру в срезе, false — номер не соответствует позиции (простые на одной клетке)
+inline bool tb_unindex(const tb_material& m, uint64_t index, Position& pos)
+{
+  const int n1 = 32 - m.wm - m.bm;
+  const uint64_t nbk = BINOMIAL.c[n1 - m.wk][m.bk], nwk = BINOMIAL.c[n1][m.wk], nbm = BINOMIAL.c[28][m.bm];
+  const uint64_t ibk = index % nbk;
+  index /= nbk;
+  const uint64_t iwk = index % nwk;
+  index /= nwk;
+  const uint64_t ibm = index % nbm;
+  const uint64_t iwm = index / nbm;
+  const uint32_t w_men = unrank_set(iwm, m.wm, 28) << 4, b_men = unrank_set(ibm, m.bm, 28);
+  if (w_men & b_men)
+    return false;
+  const uint32_t free1 = ~(w_men | b_men);
+  const uint32_t w_kings = expand_from(unrank_set(iwk, m.wk, n1), free1);
+  const uint32_t b_kings = expand_from(unrank_set(ibk, m.bk, n1 - m.wk), free1 & ~w_kings);
+  pos.white = w_men | w_kings;
+  pos.black = b_men | b_kings;
+  pos.kings = w_kings | b_kings;
+  pos.update_hash();
+  return true;
+}
+
+// Заголовок файла таблиц: смещения срезов от начала файла, 0 — среза нет
+struct tb_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t max_pieces;
+  uint64_t offsets[TB_MAX_PIECES + 1][TB_MAX_PIECES + 1][TB_MAX_PIECES + 1][TB_MAX_PIECES + 1];
+};
+
+const char TB_MAGIC[8] = { 'C', 'H', 'K', 'R', 'T', 'B', '0', '1' };
+const uint32_t TB_VERSION = 1;
+
+/**
+ * Эндшпильные таблицы, отображённые в память только для чтения
+ * Запросы из нескольких потоков поиска безопасны: данные не меняются
+ */
+class Tablebase
+{
+public:
+  // Открывает файл таблиц, при ошибке возвращает false и таблицы не используются
+  bool open(const std::string& path)
+  {
+    if (!file.open(path))
+      return false;
+    if (file.size() < sizeof(tb_header) || std::memcmp(header()->magic, TB_MAGIC, sizeof(TB_MAGIC)) != 0 ||
+      header()->version != TB_VERSION || header()->max_pieces > unsigned(TB_MAX_PIECES))
+    {
+      file.close();
+      return false;
+    }
+    return true;
+  }
+
+  void close()
+  {
+    file.close();
+  }
+
+  bool is_open() const
+  {
+    return file.is_open();
+  }
+
+  // Наибольшее число фигур в таблицах (0 — таблицы не открыты)
+  int max_pieces() const
+  {
+    return file.is_open() ? int(header()->max_pieces) : 0;
+  }
+
+  /**
+   * Результат позиции для стороны color, которая ходит
+   * false — позиции нет в таблицах
+   */
+  bool probe(const Position& pos, const bool color, tb_entry& res) const
+  {
+    if (popcount(pos.white | pos.black) > max_pieces())
+      return false;
+    const Position p = color ? flip_colors(pos) : pos;
+    const tb_material m = material_of(p);
+    if (m.wm + m.wk == 0)
+    {
+      res = { TbResult::LOSS, 0 };
+      return true;
+    }
+    if (m.bm + m.bk == 0 || (p.white & ~p.kings & TOP_ROW) || (p.black & ~p.kings & BOTTOM_ROW))
+      return false;
+    const uint64_t offset = header()->offsets[m.wm][m.wk][m.bm][m.bk];
+    if (!offset)
+      return false;
+    const uint64_t at = offset + tb_index(p, m);
+    if (at >= file.size())
+      return false;
+    res = tb_decode(file.data()[at]);
+    return true;
+  }
+
+private:
+  const tb_header* header() const
+  {
+    return reinterpret_cast<const tb_header*>(file.data());
+  }
+
+  MappedFile file;
+};
@@ -0,0 +1,137 @@
+﻿#pragma once
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+
+#include "../Models/Position.h"
+
+// Тип оценки, сохранённой в таблице
+enum class Bound : uint8_t
+{
+  NONE,   // Пустая запись
+  EXACT,  // Точная оценка
+  LOWER,  // Оценка не меньше сохранённой (было отсечение в узле максимума)
+  UPPER   // Оценка не больше сохранённой (было отсечение в узле минимума)
+};
+
+// Запись таблицы транспозиций
+struct tt_entry
+{
+  double score = 0;
+  SQ_T from = NO_SQ, to = NO_SQ;  // Лучший ход в позиции
+  int8_t depth = -1;              // Оставшаяся глубина поиска
+  Bound bound = Bound::NONE;
+  uint8_t age = 0;                // Номер поиска, в котором сделана запись
+};
+
+/**
+ * Таблица транспозиций фиксированного размера, общая для всех потоков поиска
+ * Индекс записи — младшие биты хеша, при коллизии предпочитается более глубокая или более новая запись
+ * Запись хранится тремя атомарными словами, ключ сохраняется в виде key ^ score ^ data:
+ * запись, разорванная одновременной записью из другого потока, просто не совпадёт по ключу
+ */
+class TransTable
+{
+public:
+  TransTable() = default;
+
+  explicit TransTable(const size_t size_mb)
+  {
+    resize(size_mb);
+  }
+
+  // Задаёт размер таблицы в мегабайтах (округляется вниз до степени двойки записей)
+  void resize(const size_t size_mb)
+  {
+    size_t count = 1;
+    while (count * 2 * sizeof(slot) <= size_mb * 1024 * 1024)
+      count *= 2;
+    count = size_mb ? count : 0;
+    table.reset(count ? new slot[count] : nullptr);
+    mask = count ? count - 1 : 0;
+  }
+
+  // Очищает все записи
+  void clear()
+  {
+    for (size_t i = 0; table && i <= mask; ++i)
+    {
+      table[i].check.store(0, std::memory_order_relaxed);
+      table[i].score.store(0, std::memory_order_relaxed);
+      table[i].data.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Начало нового поиска: старые записи становятся кандидатами на замену
+  void new_search()
+  {
+    ++age;
+  }
+
+  // Ищет запись по ключу, false если её нет
+  bool probe(const uint64_t key, tt_entry& e) const
+  {
+    if (!table)
+      return false;
+    const slot& s = table[key & mask];
+    const uint64_t score = s.score.load(std::memory_order_relaxed);
+    const uint64_t data = s.data.load(std::memory_order_relaxed);
+    if (!data || (s.check.load(std::memory_order_relaxed) ^ score ^ data) != key)
+      return false;
+    e = unpack(score, data);
+    return true;
+  }
+
+  // Сохраняет результат поиска в позиции
+  void store(const uint64_t key, const int depth, const Bound bound, const double score, const sq_move& best)
+  {
+    if (!table)
+      return;
+    slot& s = table[key & mask];
+    const uint64_t old_score = s.score.load(std::memory_order_relaxed);
+    const uint64_t old_data = s.data.load(std::memory_order_relaxed);
+    if (old_data && (s.check.load(std::memory_order_relaxed) ^ old_score ^ old_data) != key)
+    {
+      const tt_entry old = unpack(old_score, old_data);
+      if (old.age == age && old.depth > depth)
+        return;
+    }
+    uint64_t score_bits;
+    memcpy(&score_bits, &score, sizeof(score));
+    const uint64_t data = uint64_t(uint8_t(bound)) | (uint64_t(uint8_t(depth)) << 8) |
+      (uint64_t(uint8_t(best.from)) << 16) | (uint64_t(uint8_t(best.to)) << 24) | (uint64_t(age) << 32);
+    s.check.store(key ^ score_bits ^ data, std::memory_order_relaxed);
+    s.score.store(score_bits, std::memory_order_relaxed);
+    s.data.store(data, std::memory_order_relaxed);
+  }
+
+  bool empty() const
+  {
+    return !table;
+  }
+
+private:
+  struct slot
+  {
+    std::atomic<uint64_t> check{ 0 };
+    std::atomic<uint64_t> score{ 0 };
+    std::atomic<uint64_t> data{ 0 };
+  };
+
+  static tt_entry unpack(const uint64_t score, const uint64_t data)
+  {
+    tt_entry e;
+    memcpy(&e.score, &score, sizeof(score));
+    e.bound = Bound(data & 0xFF);
+    e.depth = int8_t(data >> 8);
+    e.from = SQ_T(data >> 16);
+    e.to = SQ_T(data >> 24);
+    e.age = uint8_t(data >> 32);
+    return e;
+  }
+
+  std::unique_ptr<slot[]> table;
+  size_t mask = 0;
+  uint8_t age = 0;
+};
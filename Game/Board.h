@@ -1,8 +1,10 @@
 ﻿#pragma once
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <vector>
 
+#include "../Models/GameHistory.h"
 #include "../Models/Move.h"
 #include "../Models/Project_path.h"
 
@@ -50,6 +52,8 @@ public:
       return 1;
     }
 
+    // Копирования из одного атласа рендерер отправляет видеокарте пакетами
+    SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
     ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (ren == nullptr)
     {
@@ -57,23 +61,16 @@ public:
       return 1;
     }
 
-    // Загрузка текстур
-    board = IMG_LoadTexture(ren, board_path.c_str());
-    w_piece = IMG_LoadTexture(ren, piece_white_path.c_str());
-    b_piece = IMG_LoadTexture(ren, piece_black_path.c_str());
-    w_queen = IMG_LoadTexture(ren, queen_white_path.c_str());
-    b_queen = IMG_LoadTexture(ren, queen_black_path.c_str());
-    back = IMG_LoadTexture(ren, back_path.c_str());
-    replay = IMG_LoadTexture(ren, replay_path.c_str());
-
-    if (!board || !w_piece || !b_piece || !w_queen || !b_queen || !back || !replay)
+    // Загрузка всех картинок, включая итоги партии, в одну текстуру
+    if (!load_atlas())
     {
-      print_exception("IMG_LoadTexture can't load main textures from " + textures_path);
+      print_exception("IMG_Load can't load textures from " + textures_path);
       return 1;
     }
 
     SDL_GetRendererOutputSize(ren, &W, &H);
     make_start_mtx();
+    create_scene();
     rerender();  // Перерисовка начальной доски
     return 0;
   }
@@ -82,8 +79,7 @@ public:
   void redraw()
   {
     game_results = -1;
-    history_mtx.clear();
-    history_beat_series.clear();
+    frame_changed = true;
     make_start_mtx();
     clear_active();
     clear_highlight();
@@ -96,24 +92,15 @@ public:
     {
       mtx[turn.xb][turn.yb] = 0;
     }
-    move_piece(turn.x, turn.y, turn.x2, turn.y2, beat_series);
+    shift_piece(turn.x, turn.y, turn.x2, turn.y2);
+    history.push(sq_move(turn), beat_series); // Сохраняем шаг
   }
 
-  // Основная логика перемещения фигуры
+  // Перемещение фигуры без взятия
   void move_piece(const POS_T i, const POS_T j, const POS_T i2, const POS_T j2, const int beat_series = 0)
   {
-    if (mtx[i2][j2])
-      throw runtime_error("final position is not empty, can't move");
-    if (!mtx[i][j])
-      throw runtime_error("begin position is empty, can't move");
-
-    // Превращение в дамку
-    if ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == 7))
-      mtx[i][j] += 2;
-
-    mtx[i2][j2] = mtx[i][j];
-    drop_piece(i, j);
-    add_history(beat_series); // Сохраняем состояние
+    shift_piece(i, j, i2, j2);
+    history.push(sq_move(to_sq(i, j), to_sq(i2, j2)), beat_series);
   }
 
   // Удаление фигуры и перерисовка
@@ -132,11 +119,24 @@ public:
     rerender();
   }
 
-  vector<vector<POS_T>> get_board() const
+  // Текущая доска без копирования
+  const vector<vector<POS_T>>& get_board() const
   {
     return mtx;
   }
 
+  // Текущая расстановка в битовом виде
+  const Position& get_position() const
+  {
+    return history.position();
+  }
+
+  // История партии по шагам
+  const GameHistory& get_history() const
+  {
+    return history;
+  }
+
   // Подсветить возможные клетки хода
   void highlight_cells(vector<pair<POS_T, POS_T>> cells)
   {
@@ -182,13 +182,13 @@ public:
   // Откат ходов назад (например, после серии взятий)
   void rollback()
   {
-    auto beat_series = max(1, *(history_beat_series.rbegin()));
-    while (beat_series-- && history_mtx.size() > 1)
+    history.undo_turn();
+    const Position& pos = history.position();
+    for (POS_T i = 0; i < 8; ++i)
     {
-      history_mtx.pop_back();
-      history_beat_series.pop_back();
+      for (POS_T j = 0; j < 8; ++j)
+        mtx[i][j] = ((i + j) % 2) ? pos.at(to_sq(i, j)) : 0;
     }
-    mtx = *(history_mtx.rbegin());
     clear_highlight();
     clear_active();
   }
@@ -197,26 +197,38 @@ public:
   void show_final(const int res)
   {
     game_results = res;
+    frame_changed = true;
     rerender();
   }
 
-  // Обновить размеры окна и перерисовать
+  // Подпись окна: "Checkers" и состояние игры после дефиса, пустое status — только название
+  void set_status(const string& status)
+  {
+    if (win)
+      SDL_SetWindowTitle(win, status.empty() ? "Checkers" : ("Checkers - " + status).c_str());
+  }
+
+  // Обновить размеры окна и перерисовать (также после потери текстур кадра)
   void reset_window_size()
   {
     SDL_GetRendererOutputSize(ren, &W, &H);
+    create_scene();
+    rerender();
+  }
+
+  // Повторно вывести кадр, например когда окно снова стало видно
+  void refresh()
+  {
+    frame_changed = true;
     rerender();
   }
 
   // Очистка ресурсов SDL
   void quit()
   {
-    SDL_DestroyTexture(board);
-    SDL_DestroyTexture(w_piece);
-    SDL_DestroyTexture(b_piece);
-    SDL_DestroyTexture(w_queen);
-    SDL_DestroyTexture(b_queen);
-    SDL_DestroyTexture(back);
-    SDL_DestroyTexture(replay);
+    destroy_scene();
+    if (atlas)
+      SDL_DestroyTexture(atlas);
     SDL_DestroyRenderer(ren);
     SDL_DestroyWindow(win);
     SDL_Quit();
@@ -229,11 +241,20 @@ public:
   }
 
 private:
-  // Добавить текущее состояние в историю
-  void add_history(const int beat_series = 0)
+  // Перемещение фигуры по матрице с превращением в дамку
+  void shift_piece(const POS_T i, const POS_T j, const POS_T i2, const POS_T j2)
   {
-    history_mtx.push_back(mtx);
-    history_beat_series.push_back(beat_series);
+    if (mtx[i2][j2])
+      throw runtime_error("final position is not empty, can't move");
+    if (!mtx[i][j])
+      throw runtime_error("begin position is empty, can't move");
+
+    // Превращение в дамку
+    if ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == 7))
+      mtx[i][j] += 2;
+
+    mtx[i2][j2] = mtx[i][j];
+    drop_piece(i, j);
   }
 
   // Заполнение стартовой матрицы фигур
@@ -250,94 +271,284 @@ private:
           mtx[i][j] = 1;
       }
     }
-    add_history();
+    history.reset(Position::from_mtx(mtx));
   }
 
-  // Основная функция отрисовки
-  void rerender()
+  // Картинки в атласе
+  enum Sprite
   {
-    SDL_RenderClear(ren);
-    SDL_RenderCopy(ren, board, NULL, NULL);
+    BOARD_SPRITE,
+    W_PIECE_SPRITE,
+    B_PIECE_SPRITE,
+    W_QUEEN_SPRITE,
+    B_QUEEN_SPRITE,
+    BACK_SPRITE,
+    REPLAY_SPRITE,
+    WHITE_WINS_SPRITE,
+    BLACK_WINS_SPRITE,
+    DRAW_SPRITE,
+    SPRITE_COUNT
+  };
+
+  /**
+   * Загружает все картинки в одну текстуру-атлас
+   * Картинки раскладываются полками по убыванию высоты, из ширин, при которых атлас влезает
+   * в предельный размер текстуры, берётся дающая наименьшую площадь. Если не влезает ни при какой,
+   * все картинки одинаково уменьшаются
+   */
+  bool load_atlas()
+  {
+    const string paths[SPRITE_COUNT] = { board_path, piece_white_path, piece_black_path, queen_white_path,
+      queen_black_path, back_path, replay_path, white_path, black_path, draw_path };
+    SDL_Surface* images[SPRITE_COUNT] = {};
+    bool loaded = true;
+    for (int k = 0; k < SPRITE_COUNT; ++k)
+    {
+      SDL_Surface* image = IMG_Load(paths[k].c_str());
+      if (image)
+      {
+        images[k] = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(image);
+      }
+      loaded = loaded && images[k];
+    }
 
-    // Отрисовка всех фигур
-    for (POS_T i = 0; i < 8; ++i)
+    if (loaded)
     {
-      for (POS_T j = 0; j < 8; ++j)
+      int limit = 4096;
+      SDL_RendererInfo info;
+      if (SDL_GetRendererInfo(ren, &info) == 0 && info.max_texture_width > 0 && info.max_texture_height > 0)
+        limit = min(info.max_texture_width, info.max_texture_height);
+
+      int order[SPRITE_COUNT];
+      for (int k = 0; k < SPRITE_COUNT; ++k)
+        order[k] = k;
+      sort(order, order + SPRITE_COUNT, [&](const int a, const int b) { return images[a]->h > images[b]->h; });
+
+      double scale = 1;
+      int atlas_w = 0, atlas_h = 0;
+      while (true)
       {
-        if (!mtx[i][j])
-          continue;
-        int wpos = W * (j + 1) / 10 + W / 120;
-        int hpos = H * (i + 1) / 10 + H / 120;
-        SDL_Rect rect{ wpos, hpos, W / 12, H / 12 };
-
-        SDL_Texture* piece_texture;
-        if (mtx[i][j] == 1)
-          piece_texture = w_piece;
-        else if (mtx[i][j] == 2)
-          piece_texture = b_piece;
-        else if (mtx[i][j] == 3)
-          piece_texture = w_queen;
-        else
-          piece_texture = b_queen;
-
-        SDL_RenderCopy(ren, piece_texture, NULL, &rect);
+        int widest = 0;
+        for (int k = 0; k < SPRITE_COUNT; ++k)
+        {
+          sprites[k].w = max(1, int(images[k]->w * scale));
+          sprites[k].h = max(1, int(images[k]->h * scale));
+          widest = max(widest, sprites[k].w);
+        }
+        long long best_area = -1;
+        int lowest = widest;
+        for (int width = widest; width <= limit; width += 64)
+        {
+          const int height = pack_shelves(order, width);
+          lowest = (width == widest) ? height : min(lowest, height);
+          if (height <= limit && (best_area < 0 || (long long)width * height < best_area))
+          {
+            best_area = (long long)width * height;
+            atlas_w = width;
+            atlas_h = height;
+          }
+        }
+        if (best_area >= 0)
+          break;
+        scale *= 0.95 * limit / max(lowest, widest);
+      }
+      pack_shelves(order, atlas_w);
+
+      SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, atlas_w, atlas_h, 32, SDL_PIXELFORMAT_RGBA32);
+      if (sheet)
+      {
+        for (int k = 0; k < SPRITE_COUNT; ++k)
+        {
+          SDL_SetSurfaceBlendMode(images[k], SDL_BLENDMODE_NONE);
+          SDL_BlitScaled(images[k], nullptr, sheet, &sprites[k]);
+        }
+        atlas = SDL_CreateTextureFromSurface(ren, sheet);
+        SDL_FreeSurface(sheet);
       }
+      if (atlas)
+        SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
     }
 
-    // Отрисовка подсвеченных клеток
-    SDL_SetRenderDrawColor(ren, 0, 255, 0, 0);
-    const double scale = 2.5;
-    SDL_RenderSetScale(ren, scale, scale);
-    for (POS_T i = 0; i < 8; ++i)
+    for (int k = 0; k < SPRITE_COUNT; ++k)
     {
-      for (POS_T j = 0; j < 8; ++j)
+      if (images[k])
+        SDL_FreeSurface(images[k]);
+    }
+    return atlas != nullptr;
+  }
+
+  // Раскладывает картинки полками шириной width (размеры уже в sprites), возвращает высоту атласа
+  int pack_shelves(const int* order, const int width)
+  {
+    const int gap = 2;  // Зазор, чтобы при сглаживании не подмешивались соседние картинки
+    int x = 0, y = 0, shelf_h = 0;
+    for (int n = 0; n < SPRITE_COUNT; ++n)
+    {
+      SDL_Rect& rect = sprites[order[n]];
+      if (x > 0 && x + rect.w > width)
       {
-        if (!is_highlighted_[i][j])
-          continue;
-        SDL_Rect cell{ int(W * (j + 1) / 10 / scale), int(H * (i + 1) / 10 / scale),
-                      int(W / 10 / scale), int(H / 10 / scale) };
-        SDL_RenderDrawRect(ren, &cell);
+        y += shelf_h + gap;
+        x = 0;
+        shelf_h = 0;
       }
+      rect.x = x;
+      rect.y = y;
+      x += rect.w + gap;
+      shelf_h = max(shelf_h, rect.h);
     }
+    return y + shelf_h;
+  }
 
-    // Отрисовка активной клетки
-    if (active_x != -1)
+  /**
+   * Создаёт под текущий размер окна фон (доска и кнопки) и кадр с фигурами
+   * Кадр хранится между перерисовками, поэтому rerender обновляет в нём только изменившиеся клетки.
+   * Если рендерер не умеет рисовать в текстуру, кадр каждый раз рисуется целиком
+   */
+  void create_scene()
+  {
+    destroy_scene();
+    if (SDL_RenderTargetSupported(ren))
     {
-      SDL_SetRenderDrawColor(ren, 255, 0, 0, 0);
-      SDL_Rect active_cell{ int(W * (active_y + 1) / 10 / scale), int(H * (active_x + 1) / 10 / scale),
-                           int(W / 10 / scale), int(H / 10 / scale) };
-      SDL_RenderDrawRect(ren, &active_cell);
+      background = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, W, H);
+      scene = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, W, H);
+      if (!background || !scene)
+        destroy_scene();
     }
-    SDL_RenderSetScale(ren, 1, 1);
+    if (scene)
+    {
+      SDL_SetTextureBlendMode(background, SDL_BLENDMODE_NONE);
+      SDL_SetTextureBlendMode(scene, SDL_BLENDMODE_NONE);
+      SDL_SetRenderTarget(ren, background);
+      draw_background();
+      SDL_SetRenderTarget(ren, scene);
+      SDL_RenderCopy(ren, background, NULL, NULL);
+      SDL_SetRenderTarget(ren, NULL);
+    }
+    for (auto& row : shown)
+      row.assign(8, -1);
+    frame_changed = true;
+  }
+
+  void destroy_scene()
+  {
+    if (background)
+      SDL_DestroyTexture(background);
+    if (scene)
+      SDL_DestroyTexture(scene);
+    background = scene = nullptr;
+  }
 
-    // Кнопки управления
+  // Доска и кнопки управления
+  void draw_background()
+  {
+    SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+    SDL_RenderClear(ren);
+    SDL_RenderCopy(ren, atlas, &sprites[BOARD_SPRITE], NULL);
     SDL_Rect rect_left{ W / 40, H / 40, W / 15, H / 15 };
-    SDL_RenderCopy(ren, back, NULL, &rect_left);
+    SDL_RenderCopy(ren, atlas, &sprites[BACK_SPRITE], &rect_left);
     SDL_Rect replay_rect{ W * 109 / 120, H / 40, W / 15, H / 15 };
-    SDL_RenderCopy(ren, replay, NULL, &replay_rect);
+    SDL_RenderCopy(ren, atlas, &sprites[REPLAY_SPRITE], &replay_rect);
+  }
 
-    // Результат игры
-    if (game_results != -1)
+  // Границы клетки в окне
+  SDL_Rect cell_rect(const POS_T i, const POS_T j) const
+  {
+    const int x = W * (j + 1) / 10, y = H * (i + 1) / 10;
+    return { x, y, W * (j + 2) / 10 - x, H * (i + 2) / 10 - y };
+  }
+
+  // Что нарисовано в клетке: фигура, подсветка и выделение одним числом
+  int cell_state(const POS_T i, const POS_T j) const
+  {
+    return mtx[i][j] | (is_highlighted_[i][j] ? 8 : 0) | (i == active_x && j == active_y ? 16 : 0);
+  }
+
+  // Фигура и рамки клетки поверх фона
+  void draw_cell(const POS_T i, const POS_T j)
+  {
+    if (mtx[i][j])
     {
-      string result_path = draw_path;
-      if (game_results == 1) result_path = white_path;
-      else if (game_results == 2) result_path = black_path;
+      int wpos = W * (j + 1) / 10 + W / 120;
+      int hpos = H * (i + 1) / 10 + H / 120;
+      SDL_Rect rect{ wpos, hpos, W / 12, H / 12 };
+      SDL_RenderCopy(ren, atlas, &sprites[W_PIECE_SPRITE + mtx[i][j] - 1], &rect);
+    }
+    // Рамка подсвеченной клетки зелёная, активной — красная
+    if (is_highlighted_[i][j])
+      draw_frame(cell_rect(i, j), 0, 255, 0);
+    if (i == active_x && j == active_y)
+      draw_frame(cell_rect(i, j), 255, 0, 0);
+  }
 
-      SDL_Texture* result_texture = IMG_LoadTexture(ren, result_path.c_str());
-      if (result_texture == nullptr)
+  // Рамка внутри клетки
+  void draw_frame(const SDL_Rect& cell, const int r, const int g, const int b)
+  {
+    const int t = 3;
+    const SDL_Rect sides[4] = { { cell.x, cell.y, cell.w, t }, { cell.x, cell.y + cell.h - t, cell.w, t },
+      { cell.x, cell.y, t, cell.h }, { cell.x + cell.w - t, cell.y, t, cell.h } };
+    SDL_SetRenderDrawColor(ren, r, g, b, 255);
+    SDL_RenderFillRects(ren, sides, 4);
+  }
+
+  /**
+   * Вывод доски на экран
+   * Перерисовываются только клетки, изменившиеся с прошлого кадра; если не изменилось ничего,
+   * кадр не выводится вовсе. Итог партии накладывается поверх кадра
+   */
+  void rerender()
+  {
+    if (!ren || !atlas)
+      return;
+    bool changed = frame_changed;
+    if (scene)
+      SDL_SetRenderTarget(ren, scene);
+    for (POS_T i = 0; i < 8; ++i)
+    {
+      for (POS_T j = 0; j < 8; ++j)
+      {
+        const int state = cell_state(i, j);
+        if (state == shown[i][j])
+          continue;
+        shown[i][j] = state;
+        changed = true;
+        if (scene)
+        {
+          const SDL_Rect cell = cell_rect(i, j);
+          SDL_RenderCopy(ren, background, &cell, &cell);
+          draw_cell(i, j);
+        }
+      }
+    }
+    if (scene)
+      SDL_SetRenderTarget(ren, NULL);
+    if (!changed)
+      return;
+
+    if (scene)
+      SDL_RenderCopy(ren, scene, NULL, NULL);
+    else
+    {
+      draw_background();
+      for (POS_T i = 0; i < 8; ++i)
       {
-        print_exception("IMG_LoadTexture can't load game result picture from " + result_path);
-        return;
+        for (POS_T j = 0; j < 8; ++j)
+          draw_cell(i, j);
       }
+    }
+
+    // Результат игры
+    if (game_results != -1)
+    {
+      Sprite result = DRAW_SPRITE;
+      if (game_results == 1) result = WHITE_WINS_SPRITE;
+      else if (game_results == 2) result = BLACK_WINS_SPRITE;
       SDL_Rect res_rect{ W / 5, H * 3 / 10, W * 3 / 5, H * 2 / 5 };
-      SDL_RenderCopy(ren, result_texture, NULL, &res_rect);
-      SDL_DestroyTexture(result_texture);
+      SDL_RenderCopy(ren, atlas, &sprites[result], &res_rect);
     }
 
     SDL_RenderPresent(ren);
-    SDL_Delay(10);
-    SDL_Event windowEvent;
-    SDL_PollEvent(&windowEvent);
+    frame_changed = false;
   }
 
   // Логгирование ошибок
@@ -350,14 +561,14 @@ private:
 public:
   int W = 0;
   int H = 0;
-  vector<vector<vector<POS_T>>> history_mtx;
 
 private:
   SDL_Window* win = nullptr;
   SDL_Renderer* ren = nullptr;
-  SDL_Texture* board = nullptr, * w_piece = nullptr, * b_piece = nullptr;
-  SDL_Texture* w_queen = nullptr, * b_queen = nullptr;
-  SDL_Texture* back = nullptr, * replay = nullptr;
+  SDL_Texture* atlas = nullptr;       // Все картинки одной текстурой
+  SDL_Rect sprites[SPRITE_COUNT] = {}; // Положение картинок в атласе
+  SDL_Texture* background = nullptr;  // Доска и кнопки под размер окна
+  SDL_Texture* scene = nullptr;       // Последний выведенный кадр без итога партии
   const string textures_path = project_path + "Textures/";
   const string board_path = textures_path + "board.png";
   const string piece_white_path = textures_path + "piece_white.png";
@@ -374,5 +585,8 @@ private:
   vector<vector<POS_T>> mtx = vector<vector<POS_T>>(8, vector<POS_T>(8));
   vector<vector<POS_T>> is_highlighted_ = vector<vector<POS_T>>(8, vector<POS_T>(8));
   int active_x = -1, active_y = -1;
-  vector<int> history_beat_series;
+  // Состояние клеток в кадре scene (cell_state), -1 — клетку нужно перерисовать
+  vector<vector<int>> shown = vector<vector<int>>(8, vector<int>(8, -1));
+  bool frame_changed = true;  // Кадр нужно вывести, даже если клетки не изменились
+  GameHistory history;
 };
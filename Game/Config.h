@@ -1,32 +1,304 @@
 ﻿#pragma once
+#include <filesystem>
 #include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "../Models/GameSettings.h"
 #include "../Models/Project_path.h"
 
+// Ошибка в settings.json: неверный тип, значение вне допустимых пределов или неизвестный ключ
+class config_error : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Настройки из settings.json
+ * Файл разбирается один раз в проверенную структуру game_settings (снимок), игра и потоки поиска
+ * читают текущий снимок без блокировок. Снимки не меняются; снимок живёт, пока его держит хоть один читатель,
+ * поэтому полученный снимок остаётся верным и после перезагрузки, а старые освобождаются сами
+ * Изменения файла отслеживаются (inotify в Linux, время изменения файла в остальных системах),
+ * poll_reload подхватывает их без перезапуска партии. Файл с ошибкой не применяется: остаются прежние настройки
+ */
 class Config
 {
   public:
     // При создании объекта Config() сразу загружает настройки из файла settings.json
     Config()
     {
-      reload();
+        publish(std::make_shared<const game_settings>());
+        start_watch();
+        reload();
+    }
+
+    Config(const Config&) = delete;
+    Config& operator=(const Config&) = delete;
+
+    ~Config()
+    {
+#ifdef __linux__
+        if (watch_fd >= 0)
+            close(watch_fd);
+#endif
+    }
+
+    // Текущий снимок настроек, читать можно из любого потока; снимок держится, пока жив указатель
+    std::shared_ptr<const game_settings> settings() const
+    {
+        return std::atomic_load_explicit(&current, std::memory_order_acquire);
+    }
+
+    /**
+     * Перечитывает settings.json и публикует новый снимок, возвращает true при успехе
+     * Если файл не открывается, не разбирается или значения неверны, снимок остаётся прежним,
+     * а причина запоминается для take_error
+     * Перезагружать настройки можно только из одного потока
+     */
+    bool reload()
+    {
+        try
+        {
+            std::ifstream fin(settings_path());
+            if (!fin)
+                throw config_error("can't open " + settings_path());
+            json config;
+            fin >> config;
+            publish(std::make_shared<const game_settings>(parse(config)));
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            error = string("settings.json: ") + e.what();
+        }
+        return false;
     }
 
-    // Загружает JSON-файл settings.json в переменную config
-    void reload()
+    // Если settings.json изменился, перечитывает его; не ждёт, возвращает true, если снимок обновлён
+    bool poll_reload()
     {
-        std::ifstream fin(project_path + "settings.json");
-        fin >> config;
-        fin.close();
+        return file_changed() && reload();
     }
 
-    auto operator()(const string &setting_dir, const string &setting_name) const
+    // Последняя ошибка загрузки настроек (пусто — ошибок не было), после вызова забывается
+    string take_error()
     {
-        return config[setting_dir][setting_name];
+        string res;
+        res.swap(error);
+        return res;
     }
 
   private:
-    json config;
+    static string settings_path()
+    {
+        return project_path + "settings.json";
+    }
+
+    // Прежний снимок освобождается, когда его отпустит последний читатель
+    void publish(std::shared_ptr<const game_settings> next)
+    {
+        std::atomic_store_explicit(&current, std::move(next), std::memory_order_release);
+    }
+
+    // Разбор и проверка всего файла
+    static game_settings parse(const json& config)
+    {
+        if (!config.is_object())
+            throw config_error("the root must be an object");
+        check_keys(config, "", { "WindowSize", "Bot", "Game" });
+        game_settings res;
+
+        const json& window = section(config, "WindowSize");
+        check_keys(window, "WindowSize", { "Width", "Hight" });
+        res.window_width = get_int(window, "WindowSize", "Width", res.window_width, 0, 16384);
+        res.window_height = get_int(window, "WindowSize", "Hight", res.window_height, 0, 16384);
+
+        const json& bot = section(config, "Bot");
+        check_keys(bot, "Bot", { "IsWhiteBot", "IsBlackBot", "WhiteBotLevel", "BlackBotLevel", "BotDelayMS", "White", "Black",
+            "BotScoringType", "Optimization", "NoRandom", "Quiescence", "HashSizeMB", "BotTimeMS", "Threads", "Ponder",
+            "TablebasePath", "BookPath" });
+        res.bot_delay_ms = get_int(bot, "Bot", "BotDelayMS", res.bot_delay_ms, 0, 3600000);
+        const bot_settings common = get_bot_settings(bot, "Bot", bot_settings());
+        const char* colors[2] = { "White", "Black" };
+        for (int color = 0; color < 2; ++color)
+        {
+            player_profile& player = res.players[color];
+            const string name = colors[color];
+            player.is_bot = get_bool(bot, "Bot", ("Is" + name + "Bot").c_str(), player.is_bot);
+            player.level = get_int(bot, "Bot", (name + "BotLevel").c_str(), player.level, 0, MAX_BOT_LEVEL);
+            // Поправки для одного цвета: те же ключи поиска, что и в разделе "Bot"
+            const json& own = section(bot, name.c_str(), "Bot");
+            check_keys(own, "Bot." + name, { "BotScoringType", "Optimization", "NoRandom", "Quiescence", "HashSizeMB",
+                "BotTimeMS", "Threads", "Ponder", "TablebasePath", "BookPath" });
+            player.bot = get_bot_settings(own, "Bot." + name, common);
+        }
+
+        const json& game = section(config, "Game");
+        check_keys(game, "Game", { "MaxNumTurns" });
+        res.max_turns = get_int(game, "Game", "MaxNumTurns", res.max_turns, 1, 10000);
+        return res;
+    }
+
+    // Настройки поиска из obj поверх base
+    static bot_settings get_bot_settings(const json& obj, const string& where, bot_settings base)
+    {
+        base.scoring_mode = get_choice(obj, where, "BotScoringType", base.scoring_mode, { "NumberOnly", "NumberAndPotential" });
+        base.optimization = get_choice(obj, where, "Optimization", base.optimization, { "O0", "O1", "O2" });
+        base.no_random = get_bool(obj, where, "NoRandom", base.no_random);
+        base.quiescence = get_bool(obj, where, "Quiescence", base.quiescence);
+        base.hash_size_mb = unsigned(get_int(obj, where, "HashSizeMB", int(base.hash_size_mb), 0, 65536));
+        base.time_limit_ms = get_int(obj, where, "BotTimeMS", base.time_limit_ms, 0, 3600000);
+        base.threads = unsigned(get_int(obj, where, "Threads", int(base.threads), 0, 256));
+        base.ponder = get_bool(obj, where, "Ponder", base.ponder);
+        // Пути в файле — от папки проекта
+        if (obj.contains("TablebasePath"))
+        {
+            const string tablebase = get_string(obj, where, "TablebasePath", "");
+            base.tablebase_path = tablebase.empty() ? tablebase : project_path + tablebase;
+        }
+        if (obj.contains("BookPath"))
+        {
+            const string book = get_string(obj, where, "BookPath", "");
+            base.book_path = book.empty() ? book : project_path + book;
+        }
+        return base;
+    }
+
+    // Раздел name внутри obj; если его нет — пустой объект
+    static const json& section(const json& obj, const char* name, const string& where = "")
+    {
+        static const json empty = json::object();
+        if (!obj.contains(name))
+            return empty;
+        const json& res = obj.at(name);
+        if (!res.is_object())
+            throw config_error(key_name(where, name) + " must be an object");
+        return res;
+    }
+
+    // Ключи, начинающиеся с "//", — комментарии, остальные должны быть из списка
+    static void check_keys(const json& obj, const string& where, std::initializer_list<const char*> keys)
+    {
+        for (const auto& item : obj.items())
+        {
+            if (item.key().compare(0, 2, "//") == 0)
+                continue;
+            bool known = false;
+            for (const char* key : keys)
+                known = known || item.key() == key;
+            if (!known)
+                throw config_error("unknown setting " + key_name(where, item.key()));
+        }
+    }
+
+    static bool get_bool(const json& obj, const string& where, const char* key, const bool def)
+    {
+        if (!obj.contains(key))
+            return def;
+        if (!obj.at(key).is_boolean())
+            throw config_error(key_name(where, key) + " must be true or false");
+        return obj.at(key).get<bool>();
+    }
+
+    static int get_int(const json& obj, const string& where, const char* key, const int def, const int lo, const int hi)
+    {
+        if (!obj.contains(key))
+            return def;
+        const json& value = obj.at(key);
+        if (!value.is_number_integer() || value.get<long long>() < lo || value.get<long long>() > hi)
+            throw config_error(key_name(where, key) + " must be an integer from " + std::to_string(lo) + " to " +
+                std::to_string(hi));
+        return value.get<int>();
+    }
+
+    static string get_string(const json& obj, const string& where, const char* key, const string& def)
+    {
+        if (!obj.contains(key))
+            return def;
+        if (!obj.at(key).is_string())
+            throw config_error(key_name(where, key) + " must be a string");
+        return obj.at(key).get<string>();
+    }
+
+    static string get_choice(const json& obj, const string& where, const char* key, const string& def,
+        std::initializer_list<const char*> choices)
+    {
+        const string value = get_string(obj, where, key, def);
+        string list;
+        for (const char* choice : choices)
+        {
+            if (value == choice)
+                return value;
+            list += (list.empty() ? "" : ", ") + string(choice);
+        }
+        throw config_error(key_name(where, key) + " must be one of " + list);
+    }
+
+    static string key_name(const string& where, const string& key)
+    {
+        return where.empty() ? key : where + "." + key;
+    }
+
+    // Начинает следить за папкой с settings.json: редакторы часто пишут новый файл и переименовывают его
+    void start_watch()
+    {
+#ifdef __linux__
+        watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watch_fd >= 0 && inotify_add_watch(watch_fd, project_path.empty() ? "." : project_path.c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            close(watch_fd);
+            watch_fd = -1;
+        }
+#endif
+        std::error_code ec;
+        last_write = std::filesystem::last_write_time(settings_path(), ec);
+    }
+
+    // Менялся ли settings.json с прошлой проверки
+    bool file_changed()
+    {
+#ifdef __linux__
+        if (watch_fd >= 0)
+        {
+            bool changed = false;
+            alignas(inotify_event) char buf[4096];
+            ssize_t len;
+            while ((len = read(watch_fd, buf, sizeof(buf))) > 0)
+            {
+                for (ssize_t i = 0; i < len;)
+                {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(buf + i);
+                    changed = changed || (event->len && string(event->name) == "settings.json");
+                    i += ssize_t(sizeof(inotify_event) + event->len);
+                }
+            }
+            return changed;
+        }
+#endif
+        std::error_code ec;
+        const auto time = std::filesystem::last_write_time(settings_path(), ec);
+        if (ec || time == last_write)
+            return false;
+        last_write = time;
+        return true;
+    }
+
+    // Текущий снимок, читается и заменяется через std::atomic_load / std::atomic_store
+    std::shared_ptr<const game_settings> current;
+    string error;
+#ifdef __linux__
+    int watch_fd = -1;
+#endif
+    std::filesystem::file_time_type last_write;
 };
@@ -1,20 +1,27 @@
 ﻿#pragma once
 #include <chrono>
-#include <thread>
+#include <ctime>
+#include <future>
 
 #include "../Models/Project_path.h"
 #include "Board.h"
 #include "Config.h"
 #include "Hand.h"
-#include "Logic.h"
+#include "../Engine/Logic.h"
+#include "../Engine/Notation.h"
+#include "../Engine/Pdn.h"
 
 class Game
 {
 public:
-  Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&board, &config)
+  Game() : board(config.settings()->window_width, config.settings()->window_height), hand(&board), logic(rules_settings())
   {
     ofstream fout(project_path + "log.txt", ios_base::trunc);
     fout.close();
+    ofstream stats_out(project_path + "search_log.jsonl", ios_base::trunc);
+    stats_out.close();
+    log_config_error();
+    apply_settings();
   }
 
   // Запуск игры в шашки
@@ -26,8 +33,11 @@ public:
     // Если это повтор игры (REPLAY), перезагружаем настройки и обновляем доску
     if (is_replay)
     {
-      logic = Logic(&board, &config);  // Создаём новую игровую логику
       config.reload();                // Обновляем конфигурацию
+      log_config_error();
+      for (auto& bot : bots)          // Новая партия — новые ИИ
+        bot.reset();
+      apply_settings();
       board.redraw();                  // Перерисовываем доску
     }
     else
@@ -39,28 +49,43 @@ public:
 
     int turn_num = -1;  // Счётчик ходов
     bool is_quit = false;  // Флаг выхода из игры
-    const int Max_turns = config("Game", "MaxNumTurns");  // Максимальное число ходов из конфига
 
-    // Основной игровой цикл
-    while (++turn_num < Max_turns)
+    // Основной игровой цикл, ограничение на число ходов — из текущих настроек
+    while (++turn_num < config.settings()->max_turns)
     {
       beat_series = 0;  // Сбрасываем счётчик серии боёв
 
-      // Определяем доступные ходы для текущего игрока (0 — белые, 1 — чёрные)
-      logic.find_turns(turn_num % 2);
+      // Изменённый settings.json применяется со следующего хода
+      if (config.poll_reload())
+        apply_settings();
+      log_config_error();
+      // Снимок держится до конца хода, даже если файл перечитают
+      const auto snapshot = config.settings();
+      const game_settings& settings = *snapshot;
+      const bool color = turn_num % 2;  // 0 — белые, 1 — чёрные
+      const player_profile& player = settings.players[color];
+      const player_profile& opponent = settings.players[!color];
+
+      // Определяем доступные ходы для текущего игрока
+      logic.find_turns(color, board.get_board());
 
       // Если ходов нет — завершаем игру
       if (logic.turns.empty())
         break;
 
-      // Устанавливаем уровень сложности бота
-      logic.Max_depth = config("Bot", string((turn_num % 2) ? "Black" : "White") + string("BotLevel"));
-
       // Проверяем, играет ли текущий цвет человек или бот
-      if (!config("Bot", string("Is") + string((turn_num % 2) ? "Black" : "White") + string("Bot")))
+      if (!player.is_bot)
       {
+        // Пока человек думает, бот-соперник обдумывает свой следующий ход
+        if (opponent.is_bot)
+          bots[!color]->start_pondering(!color, board.get_board(), opponent.level);
+
         // Ход игрока
-        auto resp = player_turn(turn_num % 2);
+        auto resp = player_turn(color);
+
+        // Обдумывание пригодится только после обычного хода
+        if (resp != Response::OK && opponent.is_bot)
+          bots[!color]->stop_pondering();
 
         if (resp == Response::QUIT)  // Выход из игры
         {
@@ -75,8 +100,7 @@ public:
         else if (resp == Response::BACK)  // Отмена хода
         {
           // Если предыдущий ход был бота, откатываем два хода
-          if (config("Bot", string("Is") + string((1 - turn_num % 2) ? "Black" : "White") + string("Bot")) &&
-            !beat_series && board.history_mtx.size() > 2)
+          if (opponent.is_bot && !beat_series && board.get_history().size() > 1)
           {
             board.rollback();
             --turn_num;
@@ -93,11 +117,35 @@ public:
       }
       else
       {
-        // Ход бота
-        bot_turn(turn_num % 2);
+        // Ход бота, пока он думает, окно отвечает на действия пользователя
+        bots[color]->Max_depth = player.level;
+        auto resp = bot_turn(color);
+        if (resp == Response::QUIT)
+        {
+          is_quit = true;
+          break;
+        }
+        else if (resp == Response::REPLAY)
+        {
+          is_replay = true;
+          break;
+        }
+        else if (resp == Response::BACK)
+        {
+          // Поиск прерван до хода бота, откатываем последний ход соперника
+          board.rollback();
+          turn_num -= 2;
+        }
       }
     }
 
+    // Партия закончилась, обдумывание больше не нужно
+    for (auto& bot : bots)
+    {
+      if (bot)
+        bot->stop_pondering();
+    }
+
     // Фиксируем время завершения игры
     auto end = chrono::steady_clock::now();
 
@@ -106,6 +154,10 @@ public:
     fout << "Game time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
     fout.close();
 
+    // Прерванная партия тоже сохраняется, с итогом "*"
+    if (is_replay || is_quit)
+      save_game("*");
+
     // Если запрошен перезапуск — начинаем заново
     if (is_replay)
       return play();
@@ -116,7 +168,7 @@ public:
 
     // Определяем результат игры
     int res = 2; // 2 — ничья или игра не завершена
-    if (turn_num == Max_turns)
+    if (turn_num == config.settings()->max_turns)
     {
       res = 0; // Ничья
     }
@@ -125,6 +177,8 @@ public:
       res = 1; // Победа одного из игроков
     }
 
+    save_game(res == 0 ? "1-1" : res == 1 ? "2-0" : "0-2");
+
     // Показываем финальный экран
     board.show_final(res);
 
@@ -142,31 +196,58 @@ public:
   }
 
 private:
-  void bot_turn(const bool color)
+  /**
+   * Ход бота: поиск идёт в отдельном потоке, а окно тем временем обрабатывает события
+   * QUIT, BACK и REPLAY во время поиска прерывают его, ход не делается и действие возвращается
+   * Во время показа серии взятий учитываются только QUIT и REPLAY, они возвращаются после хода
+   */
+  Response bot_turn(const bool color)
   {
     // Засекаем время начала хода
     auto start = chrono::steady_clock::now();
 
     // Задержка между ходами бота (из конфига)
-    auto delay_ms = config("Bot", "BotDelayMS");
-
-    // Поток для задержки хода бота
-    thread th(SDL_Delay, delay_ms);
-
-    // Находим оптимальные ходы для бота
-    auto turns = logic.find_best_turns(color);
-
-    // Ожидаем завершения потока с задержкой
-    th.join();
+    const int delay_ms = config.settings()->bot_delay_ms;
+    Logic& bot = *bots[color];
+
+    // Находим оптимальные ходы для бота, поиск идёт в счёт задержки
+    // Поток поиска сообщает о каждой итерации и о конце поиска через очередь событий окна
+    const string fen = to_fen(board.get_position(), color);
+    const string side = color ? "black" : "white";
+    auto result = bot.find_best_turns_async(color, board.get_board(),
+      [](const search_info& info) { Hand::post_search_message(Hand::SEARCH_PROGRESS, info.depth); },
+      []() { Hand::post_search_message(Hand::SEARCH_DONE); });
+    const auto ready_time = start + chrono::milliseconds(delay_ms);
+    bool ready = false;
+    while (!ready || chrono::steady_clock::now() < ready_time)
+    {
+      // Сообщение о конце поиска могло остаться от отменённого поиска, поэтому готовность проверяется по future
+      // Пока поиск идёт, окно всё равно просыпается раз в SEARCH_WAKE_MS на случай потерянного сообщения
+      const auto event = hand.next_event(ready ? ms_until(ready_time) : SEARCH_WAKE_MS);
+      if (event.resp == Response::QUIT || event.resp == Response::BACK || event.resp == Response::REPLAY)
+      {
+        bot.cancel_search();
+        board.set_status("");
+        return event.resp;
+      }
+      if (event.message == Hand::SEARCH_PROGRESS && !ready)
+        board.set_status(side + " is thinking, depth " + to_string(event.value));
+      ready = ready || result.wait_for(chrono::seconds(0)) == future_status::ready;
+    }
+    board.set_status("");
+    auto turns = result.get();
 
     bool is_first = true;
+    Response late_resp = Response::OK;
     // Применяем ходы бота
     for (auto turn : turns)
     {
       // Добавляем задержку между последовательными ходами
       if (!is_first)
       {
-        SDL_Delay(delay_ms);
+        const auto resp = wait_events(delay_ms);
+        if (resp == Response::QUIT || resp == Response::REPLAY)
+          late_resp = resp;
       }
 
       is_first = false;
@@ -184,7 +265,38 @@ private:
     // Логируем время хода бота
     ofstream fout(project_path + "log.txt", ios_base::app);
     fout << "Bot turn time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
+    const search_stats& stats = bot.last_stats();
+    fout << "Bot cutoff rate: " << int(stats.cutoff_rate() * 100) << "% of nodes, "
+      << int(stats.first_move_cutoff_rate() * 100) << "% on the first move\n";
     fout.close();
+
+    // Счётчики поиска одной строкой JSON на ход
+    ofstream stats_out(project_path + "search_log.jsonl", ios_base::app);
+    stats_out << "{\"fen\":\"" << fen << "\",\"level\":" << bot.Max_depth << ","
+      << stats.json_fields() << "}\n";
+    stats_out.close();
+    return late_resp;
+  }
+
+  // Ждёт ms миллисекунд, обрабатывая события окна, возвращает первое действие пользователя (клики по доске не в счёт)
+  Response wait_events(const int ms)
+  {
+    const auto end = chrono::steady_clock::now() + chrono::milliseconds(ms);
+    Response res = Response::OK;
+    for (int left = ms; left > 0; left = ms_until(end))
+    {
+      const auto resp = hand.next_event(left).resp;
+      if (res == Response::OK && resp != Response::CELL)
+        res = resp;
+    }
+    return res;
+  }
+
+  // Сколько миллисекунд осталось до момента time, с округлением вверх
+  static int ms_until(const chrono::steady_clock::time_point time)
+  {
+    const auto left = chrono::ceil<chrono::milliseconds>(time - chrono::steady_clock::now()).count();
+    return left > 0 ? int(left) : 0;
   }
 
   Response player_turn(const bool color)
@@ -274,7 +386,7 @@ private:
     beat_series = 1;
     while (true)
     {
-      logic.find_turns(pos.x2, pos.y2); // Проверяем возможные продолжения
+      logic.find_turns(pos.x2, pos.y2, board.get_board()); // Проверяем возможные продолжения
       if (!logic.have_beats)
         break;
 
@@ -322,10 +434,86 @@ private:
   }
 
 private:
+  // Настройки Logic, которая только генерирует ходы (для проверки ходов человека): без таблиц и лишних потоков
+  static bot_settings rules_settings()
+  {
+    bot_settings settings;
+    settings.hash_size_mb = 0;
+    return settings;
+  }
+
+  // Создаёт ИИ для цветов, которыми управляет бот; ИИ с прежними настройками поиска сохраняется вместе с таблицами
+  void apply_settings()
+  {
+    const auto snapshot = config.settings();
+    for (int color = 0; color < 2; ++color)
+    {
+      const player_profile& player = snapshot->players[color];
+      if (!player.is_bot)
+        bots[color].reset();
+      else if (!bots[color] || bot_config[color] != player.bot)
+      {
+        bots[color] = make_unique<Logic>(player.bot);
+        bot_config[color] = player.bot;
+      }
+    }
+  }
+
+  /**
+   * Дописывает партию в games.pdn: ходы берутся из истории доски, шаги одной серии взятий — один ход
+   * result — итог в записи PDN ("2-0", "0-2", "1-1" или "*")
+   */
+  void save_game(const string& result)
+  {
+    const GameHistory& history = board.get_history();
+    if (history.empty())
+      return;
+    pdn_game game;
+    const time_t now = time(nullptr);
+    char date[16] = "????.??.??";
+    if (const tm* local = localtime(&now))
+      strftime(date, sizeof(date), "%Y.%m.%d", local);
+    game.set_tag("Event", "Checkers");
+    game.set_tag("Date", date);
+    const char* tags[2] = { "White", "Black" };
+    const auto snapshot = config.settings();
+    for (int color = 0; color < 2; ++color)
+    {
+      const player_profile& player = snapshot->players[color];
+      game.set_tag(tags[color], player.is_bot ? "Bot level " + to_string(player.level) : "Human");
+    }
+    game.start = history.position_at(0);
+    game.result = result;
+    for (size_t i = 0; i < history.size(); ++i)
+    {
+      // Тихий ход и первое взятие серии начинают новый ход
+      if (history.series(i) <= 1 || game.turns.empty())
+        game.turns.emplace_back();
+      game.turns.back().push_back(history.step(i));
+    }
+    ofstream fout(project_path + "games.pdn", ios_base::app);
+    write_pdn(fout, game);
+  }
+
+  // Записывает в лог ошибку в settings.json, если она была
+  void log_config_error()
+  {
+    const string error = config.take_error();
+    if (error.empty())
+      return;
+    ofstream fout(project_path + "log.txt", ios_base::app);
+    fout << "Config error: " << error << ". Previous settings are kept\n";
+  }
+
+  // Как часто окно проверяет готовность поиска, если сообщение о его конце не пришло
+  static const int SEARCH_WAKE_MS = 100;
+
   Config config;
   Board board;
   Hand hand;
-  Logic logic;
+  Logic logic;                  // Правила: ходы человека и проверка конца партии
+  unique_ptr<Logic> bots[2];    // ИИ белых и чёрных, пусто — цветом играет человек
+  bot_settings bot_config[2];   // Настройки, с которыми созданы bots
   int beat_series;  // Счётчик серии последовательных боёв
   bool is_replay = false;
 };
\ No newline at end of file
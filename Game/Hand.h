@@ -1,125 +1,138 @@
 ﻿#pragma once
+#include <stdint.h>
 #include <tuple>
 
 #include "../Models/Move.h"
 #include "../Models/Response.h"
 #include "Board.h"
 
-// Класс для обработки пользовательского ввода (мышь, окно)
+// Событие для игры: действие пользователя или сообщение потока поиска
+struct game_event
+{
+  Response resp = Response::OK;  // QUIT, BACK, REPLAY или CELL; OK — для игры ничего не произошло
+  POS_T x = -1, y = -1;          // Клетка для CELL
+  int message = -1;              // Сообщение потока поиска (Hand::SEARCH_PROGRESS, Hand::SEARCH_DONE), -1 — нет
+  int value = 0;                 // Глубина для SEARCH_PROGRESS
+};
+
+/**
+ * Класс для обработки пользовательского ввода (мышь, окно)
+ * Все ожидания блокируются в SDL_WaitEventTimeout, поэтому ждущее окно не занимает процессор
+ * Поток поиска отправляет свои сообщения (post_search_message) в ту же очередь событий SDL
+ */
 class Hand
 {
 public:
+  // Сообщения потока поиска
+  enum SearchMessage
+  {
+    SEARCH_PROGRESS,  // Закончена итерация поиска
+    SEARCH_DONE       // Поиск закончен, результат готов
+  };
+
   // Конструктор, принимающий указатель на игровую доску
   Hand(Board* board) : board(board)
   {
   }
 
-  // Ожидает и обрабатывает клик мыши, возвращает:
-  tuple<Response, POS_T, POS_T> get_cell() const
+  // Кладёт сообщение поиска в очередь событий SDL, можно вызывать из любого потока
+  static void post_search_message(const int message, const int value = 0)
   {
-    SDL_Event windowEvent;  // Событие SDL
-    Response resp = Response::OK;  // Реакция по умолчанию
-    int x = -1, y = -1;    // Абсолютные координаты клика
-    int xc = -1, yc = -1;   // Координаты клетки на доске
+    SDL_Event event{};
+    event.type = search_event_type();
+    event.user.code = message;
+    event.user.data1 = reinterpret_cast<void*>(intptr_t(value));
+    SDL_PushEvent(&event);
+  }
 
-    // Бесконечный цикл обработки событий
-    while (true)
+  /**
+   * Ждёт одно событие не дольше timeout_ms миллисекунд (-1 — без ограничения) и обрабатывает его
+   * Изменения окна обрабатываются здесь же, наружу возвращается только то, что важно игре
+   */
+  game_event next_event(const int timeout_ms = -1) const
+  {
+    game_event res;
+    SDL_Event windowEvent;
+    const int got = (timeout_ms < 0) ? SDL_WaitEvent(&windowEvent) : SDL_WaitEventTimeout(&windowEvent, timeout_ms);
+    if (!got)
+      return res;
+
+    if (windowEvent.type == search_event_type())
+    {
+      res.message = windowEvent.user.code;
+      res.value = int(reinterpret_cast<intptr_t>(windowEvent.user.data1));
+      return res;
+    }
+
+    switch (windowEvent.type)
     {
-      if (SDL_PollEvent(&windowEvent))  // Получаем событие
+    case SDL_QUIT:  // Закрытие окна
+      res.resp = Response::QUIT;
+      break;
+
+    case SDL_MOUSEBUTTONDOWN:  // Клик мыши
+    {
+      // Преобразуем абсолютные координаты в координаты клетки
+      const int xc = int(windowEvent.motion.y / (board->H / 10) - 1);
+      const int yc = int(windowEvent.motion.x / (board->W / 10) - 1);
+
+      // Левая верхняя клетка (-1,-1) — кнопка "Назад", правая верхняя (-1,8) — кнопка "Реванш"
+      if (xc == -1 && yc == -1 && !board->get_history().empty())
+        res.resp = Response::BACK;
+      else if (xc == -1 && yc == 8)
+        res.resp = Response::REPLAY;
+      else if (xc >= 0 && xc < 8 && yc >= 0 && yc < 8)  // Клик по игровой доске
       {
-        switch (windowEvent.type)
-        {
-        case SDL_QUIT:  // Закрытие окна
-          resp = Response::QUIT;
-          break;
-
-        case SDL_MOUSEBUTTONDOWN:  // Клик мыши
-          x = windowEvent.motion.x;
-          y = windowEvent.motion.y;
-
-          // Преобразуем абсолютные координаты в координаты клетки
-          xc = int(y / (board->H / 10) - 1);
-          yc = int(x / (board->W / 10) - 1);
-
-          // Обработка специальных зон:
-          // 1. Левая верхняя клетка (-1,-1) - кнопка "Назад"
-          if (xc == -1 && yc == -1 && board->history_mtx.size() > 1)
-          {
-            resp = Response::BACK;
-          }
-          // 2. Правая верхняя клетка (-1,8) - кнопка "Реванш"
-          else if (xc == -1 && yc == 8)
-          {
-            resp = Response::REPLAY;
-          }
-          // 3. Клик по игровой доске (0-7, 0-7)
-          else if (xc >= 0 && xc < 8 && yc >= 0 && yc < 8)
-          {
-            resp = Response::CELL;
-          }
-          else  // Клик вне значимых зон
-          {
-            xc = -1;
-            yc = -1;
-          }
-          break;
-
-        case SDL_WINDOWEVENT:  // Изменение размера окна
-          if (windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
-          {
-            board->reset_window_size();  // Пересчитываем размеры
-            break;
-          }
-        }
-
-        // Если произошло значимое событие - выходим из цикла
-        if (resp != Response::OK)
-          break;
+        res.resp = Response::CELL;
+        res.x = POS_T(xc);
+        res.y = POS_T(yc);
       }
     }
-    return { resp, xc, yc };  // Возвращаем результат
+    break;
+
+    case SDL_WINDOWEVENT:  // Изменение размера окна
+      if (windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+        board->reset_window_size();  // Пересчитываем размеры
+      else if (windowEvent.window.event == SDL_WINDOWEVENT_EXPOSED)
+        board->refresh();  // Окно снова видно, выводим кадр заново
+      break;
+
+    case SDL_RENDER_TARGETS_RESET:  // Рендерер потерял сохранённый кадр
+      board->reset_window_size();
+      break;
+    }
+    return res;
   }
 
-  // Ожидает любое действие пользователя
-  Response wait() const
+  // Ожидает клик по доске или кнопке, возвращает действие и клетку
+  tuple<Response, POS_T, POS_T> get_cell() const
   {
-    SDL_Event windowEvent;
-    Response resp = Response::OK;
+    while (true)
+    {
+      const game_event event = next_event();
+      if (event.resp != Response::OK)
+        return { event.resp, event.x, event.y };
+    }
+  }
 
+  // Ожидает выход или реванш после конца партии
+  Response wait() const
+  {
     while (true)
     {
-      if (SDL_PollEvent(&windowEvent))
-      {
-        switch (windowEvent.type)
-        {
-        case SDL_QUIT:  // Закрытие окна
-          resp = Response::QUIT;
-          break;
-
-        case SDL_WINDOWEVENT_SIZE_CHANGED:  // Изменение размера
-          board->reset_window_size();
-          break;
-
-        case SDL_MOUSEBUTTONDOWN:  // Клик мыши
-        {
-          int x = windowEvent.motion.x;
-          int y = windowEvent.motion.y;
-          // Проверяем, была ли нажата кнопка "Реванш"
-          int xc = int(y / (board->H / 10) - 1);
-          int yc = int(x / (board->W / 10) - 1);
-          if (xc == -1 && yc == 8)
-            resp = Response::REPLAY;
-        }
-        break;
-        }
-
-        if (resp != Response::OK)
-          break;
-      }
+      const Response resp = next_event().resp;
+      if (resp == Response::QUIT || resp == Response::REPLAY)
+        return resp;
     }
-    return resp;
   }
 
 private:
+  // Тип событий SDL для сообщений поиска, регистрируется один раз
+  static Uint32 search_event_type()
+  {
+    static const Uint32 type = SDL_RegisterEvents(1);
+    return type;
+  }
+
   Board* board;  // Указатель на игровую доску
-};
\ No newline at end of file
+};
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <string>
+
+/**
+ * Настройки поиска ИИ, не зависящие от формата файла настроек
+ * Заполняются из раздела "Bot" файла settings.json (Config::get_bot_settings)
+ */
+struct bot_settings
+{
+  std::string scoring_mode = "NumberAndPotential";  // Оценка позиции (BotScoringType)
+  std::string optimization = "O1";                  // Режим оптимизации поиска (Optimization)
+  bool no_random = false;                           // Детерминированный выбор хода (NoRandom)
+  bool quiescence = true;                           // Поиск по взятиям за горизонтом (Quiescence)
+  unsigned hash_size_mb = 64;                       // Размер таблицы транспозиций (HashSizeMB)
+  int time_limit_ms = 0;                            // Бюджет времени на ход (BotTimeMS)
+  unsigned threads = 1;                             // Число потоков поиска (Threads)
+  std::string tablebase_path;                       // Файл эндшпильных таблиц, пусто — не использовать (TablebasePath)
+  std::string book_path;                            // Файл дебютной книги, пусто — не использовать (BookPath)
+  bool ponder = false;                              // Обдумывание на время хода человека (Ponder)
+  unsigned seed = 0;                                // Начальное значение случайных чисел, 0 — по времени
+};
+
+// Настройки совпадают: ИИ с ними можно не пересоздавать
+inline bool operator==(const bot_settings& a, const bot_settings& b)
+{
+  return a.scoring_mode == b.scoring_mode && a.optimization == b.optimization && a.no_random == b.no_random &&
+    a.quiescence == b.quiescence && a.hash_size_mb == b.hash_size_mb && a.time_limit_ms == b.time_limit_ms &&
+    a.threads == b.threads && a.tablebase_path == b.tablebase_path && a.book_path == b.book_path &&
+    a.ponder == b.ponder && a.seed == b.seed;
+}
+
+inline bool operator!=(const bot_settings& a, const bot_settings& b)
+{
+  return !(a == b);
+}
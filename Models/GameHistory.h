@@ -0,0 +1,169 @@
+﻿#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Position.h"
+
+/**
+ * История партии: упакованный журнал шагов и редкие снимки позиции
+ * Шаг — одно перемещение или одно взятие серии — занимает 4 байта и хранит всё для отмены
+ * (побитую фигуру и превращение в дамку), поэтому отмена шага — O(1) без копирования доски
+ * Каждые SNAPSHOT_INTERVAL шагов сохраняется снимок 32 клеток (12 байт), по нему быстро
+ * восстанавливается позиция на любом шаге (position_at). Текущая позиция доступна без копирования
+ */
+class GameHistory
+{
+public:
+  static const size_t SNAPSHOT_INTERVAL = 64;
+
+  GameHistory()
+  {
+    reset(Position());
+  }
+
+  explicit GameHistory(const Position& start)
+  {
+    reset(start);
+  }
+
+  // Начинает историю заново с позиции start
+  void reset(const Position& start)
+  {
+    current = start;
+    current.update_hash();
+    steps.clear();
+    snapshots.assign(1, snapshot::of(current));
+  }
+
+  /**
+   * Записывает и выполняет шаг
+   * series — номер взятия в серии (1, 2, ...), 0 — тихий ход; отмена хода снимает столько шагов
+   */
+  void push(const sq_move& step, const int series)
+  {
+    undo_info undo;
+    current.make(step, undo);
+    steps.push_back(pack(step, undo, series));
+    if (steps.size() % SNAPSHOT_INTERVAL == 0)
+      snapshots.push_back(snapshot::of(current));
+  }
+
+  // Отменяет последний шаг, возвращает его номер в серии
+  int pop()
+  {
+    if (steps.size() % SNAPSHOT_INTERVAL == 0)
+      snapshots.pop_back();
+    const uint32_t packed = steps.back();
+    steps.pop_back();
+    undo_info undo;
+    undo.beaten = POS_T((packed >> 16) & 7);
+    undo.promoted = (packed >> 19) & 1;
+    current.unmake(step_of(packed), undo);
+    current.update_hash();
+    return series_of(packed);
+  }
+
+  // Отменяет последний ход: серию взятий целиком, тихий ход — одним шагом
+  void undo_turn()
+  {
+    if (steps.empty())
+      return;
+    int count = series_of(steps.back());
+    if (count < 1)
+      count = 1;
+    while (count-- && !steps.empty())
+      pop();
+  }
+
+  // Число записанных шагов
+  size_t size() const
+  {
+    return steps.size();
+  }
+
+  bool empty() const
+  {
+    return steps.empty();
+  }
+
+  // Шаг номер i и его номер в серии
+  sq_move step(const size_t i) const
+  {
+    return step_of(steps[i]);
+  }
+
+  int series(const size_t i) const
+  {
+    return series_of(steps[i]);
+  }
+
+  // Текущая позиция
+  const Position& position() const
+  {
+    return current;
+  }
+
+  // Позиция после первых ply шагов: от ближайшего снимка не больше SNAPSHOT_INTERVAL шагов
+  Position position_at(const size_t ply) const
+  {
+    const size_t k = ply / SNAPSHOT_INTERVAL;
+    Position pos = snapshots[k].to_position();
+    for (size_t i = k * SNAPSHOT_INTERVAL; i < ply; ++i)
+      pos.apply(step_of(steps[i]));
+    return pos;
+  }
+
+  // Память под историю в байтах
+  size_t memory_bytes() const
+  {
+    return steps.capacity() * sizeof(uint32_t) + snapshots.capacity() * sizeof(snapshot);
+  }
+
+private:
+  // Расстановка без хеша: 12 байт
+  struct snapshot
+  {
+    uint32_t white, black, kings;
+
+    static snapshot of(const Position& pos)
+    {
+      return { pos.white, pos.black, pos.kings };
+    }
+
+    Position to_position() const
+    {
+      Position pos;
+      pos.white = white;
+      pos.black = black;
+      pos.kings = kings;
+      pos.update_hash();
+      return pos;
+    }
+  };
+
+  // Биты шага: 0-4 откуда, 5-9 куда, 10-15 побитая клетка (63 — нет), 16-18 побитая фигура,
+  // 19 превращение, 20-27 номер в серии
+  static uint32_t pack(const sq_move& step, const undo_info& undo, const int series)
+  {
+    const uint32_t beat = (step.beat == NO_SQ) ? 63u : uint32_t(step.beat);
+    return uint32_t(step.from) | (uint32_t(step.to) << 5) | (beat << 10) | (uint32_t(undo.beaten) << 16) |
+      (uint32_t(undo.promoted) << 19) | (uint32_t(series & 0xFF) << 20);
+  }
+
+  static sq_move step_of(const uint32_t packed)
+  {
+    const uint32_t beat = (packed >> 10) & 63;
+    return sq_move(SQ_T(packed & 31), SQ_T((packed >> 5) & 31), beat == 63 ? NO_SQ : SQ_T(beat));
+  }
+
+  static int series_of(const uint32_t packed)
+  {
+    return int((packed >> 20) & 0xFF);
+  }
+
+  Position current;
+  std::vector<uint32_t> steps;
+  // snapshots[k] — позиция после k * SNAPSHOT_INTERVAL шагов, снимков всегда size() / SNAPSHOT_INTERVAL + 1
+  std::vector<snapshot> snapshots;
+};
@@ -0,0 +1,26 @@
+﻿#pragma once
+#include "BotSettings.h"
+
+// Самый глубокий уровень ИИ, который принимают настройки
+const int MAX_BOT_LEVEL = 30;
+
+// Игрок одного цвета: человек или ИИ со своим уровнем и настройками поиска
+struct player_profile
+{
+  bool is_bot = false;  // Цветом управляет ИИ (IsWhiteBot, IsBlackBot)
+  int level = 0;        // Уровень ИИ (WhiteBotLevel, BlackBotLevel)
+  bot_settings bot;     // Раздел "Bot" с поправками из "White" или "Black"
+};
+
+/**
+ * Все настройки игры, уже проверенные и приведённые к типам
+ * Заполняются из settings.json (Config), после публикации не меняются
+ */
+struct game_settings
+{
+  int window_width = 0;      // Ширина окна, 0 — по размеру экрана (Width)
+  int window_height = 0;     // Высота окна (Hight)
+  player_profile players[2]; // 0 — белые, 1 — чёрные
+  int bot_delay_ms = 0;      // Наименьшая длительность хода ИИ (BotDelayMS)
+  int max_turns = 120;       // Ограничение на число ходов в партии (MaxNumTurns)
+};
@@ -0,0 +1,327 @@
+﻿#pragma once
+#include <stdint.h>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Move.h"
+#include "Zobrist.h"
+
+// Номер тёмной клетки доски (0..31), -1 — клетки нет
+typedef int8_t SQ_T;
+
+const SQ_T NO_SQ = -1;
+
+// Направления по диагоналям: вверх-влево, вверх-вправо, вниз-влево, вниз-вправо
+enum Dir
+{
+  UL = 0,
+  UR = 1,
+  DL = 2,
+  DR = 3
+};
+
+// Маски строк и крайних столбцов в 32-клеточной нумерации
+const uint32_t EVEN_ROWS = 0x0F0F0F0Fu;  // строки 0, 2, 4, 6 (тёмные клетки в нечётных столбцах)
+const uint32_t ODD_ROWS = 0xF0F0F0F0u;   // строки 1, 3, 5, 7 (тёмные клетки в чётных столбцах)
+const uint32_t FIRST_COL = 0x11111111u;  // первая тёмная клетка строки
+const uint32_t LAST_COL = 0x88888888u;   // последняя тёмная клетка строки
+const uint32_t TOP_ROW = 0x0000000Fu;    // строка 0 — превращение белых
+const uint32_t BOTTOM_ROW = 0xF0000000u; // строка 7 — превращение чёрных
+
+// Количество единичных битов
+inline int popcount(const uint32_t b)
+{
+#ifdef _MSC_VER
+  return int(__popcnt(b));
+#else
+  return __builtin_popcount(b);
+#endif
+}
+
+// Номер младшего единичного бита (b != 0)
+inline SQ_T lsb(const uint32_t b)
+{
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward(&idx, b);
+  return SQ_T(idx);
+#else
+  return SQ_T(__builtin_ctz(b));
+#endif
+}
+
+// Извлекает младший единичный бит
+inline SQ_T pop_lsb(uint32_t& b)
+{
+  SQ_T s = lsb(b);
+  b &= b - 1;
+  return s;
+}
+
+// Сдвиг всего множества клеток на одну клетку в направлении dir
+inline uint32_t step(const uint32_t b, const int dir)
+{
+  switch (dir)
+  {
+  case UL:
+    return ((b & EVEN_ROWS) >> 4) | ((b & ODD_ROWS & ~FIRST_COL) >> 5);
+  case UR:
+    return ((b & EVEN_ROWS & ~LAST_COL) >> 3) | ((b & ODD_ROWS) >> 4);
+  case DL:
+    return ((b & EVEN_ROWS) << 4) | ((b & ODD_ROWS & ~FIRST_COL) << 3);
+  default:
+    return ((b & EVEN_ROWS & ~LAST_COL) << 5) | ((b & ODD_ROWS) << 4);
+  }
+}
+
+// Противоположное направление
+inline int opposite(const int dir)
+{
+  return 3 - dir;
+}
+
+// Перевод координат клетки в номер (только для тёмных клеток)
+inline SQ_T to_sq(const POS_T x, const POS_T y)
+{
+  return SQ_T(x * 4 + y / 2);
+}
+
+// Строка клетки по номеру
+inline POS_T sq_x(const SQ_T s)
+{
+  return POS_T(s / 4);
+}
+
+// Столбец клетки по номеру
+inline POS_T sq_y(const SQ_T s)
+{
+  return POS_T(2 * (s % 4) + ((s / 4) % 2 == 0));
+}
+
+// Бит клетки
+inline uint32_t sq_bit(const SQ_T s)
+{
+  return uint32_t(1) << s;
+}
+
+// Таблица соседних клеток по направлениям
+struct neighbour_table
+{
+  SQ_T next[32][4];
+};
+
+constexpr neighbour_table make_neighbour_table()
+{
+  neighbour_table t{};
+  for (int s = 0; s < 32; ++s)
+  {
+    for (int dir = 0; dir < 4; ++dir)
+    {
+      int x = s / 4 + (dir < 2 ? -1 : 1);
+      int y = 2 * (s % 4) + ((s / 4) % 2 == 0) + (dir % 2 ? 1 : -1);
+      t.next[s][dir] = (x < 0 || x > 7 || y < 0 || y > 7) ? NO_SQ : SQ_T(x * 4 + y / 2);
+    }
+  }
+  return t;
+}
+
+constexpr neighbour_table NEIGHBOURS = make_neighbour_table();
+
+// Соседняя клетка в направлении dir, NO_SQ если выходит за доску
+inline SQ_T neighbour(const SQ_T s, const int dir)
+{
+  return NEIGHBOURS.next[s][dir];
+}
+
+/**
+ * Компактный ход по номерам клеток: откуда, куда и кого бьём
+ * Используется в поиске вместо move_pos
+ */
+struct sq_move
+{
+  SQ_T from, to;
+  SQ_T beat;  // Побитая фигура (NO_SQ — ход без взятия)
+
+  // Неинициализированный ход (для списков ходов фиксированного размера)
+  sq_move() = default;
+
+  sq_move(const SQ_T from, const SQ_T to, const SQ_T beat = NO_SQ) : from(from), to(to), beat(beat)
+  {
+  }
+
+  // Преобразование из хода в координатах доски
+  explicit sq_move(const move_pos& turn)
+    : from(to_sq(turn.x, turn.y)), to(to_sq(turn.x2, turn.y2)),
+    beat(turn.xb != -1 ? to_sq(turn.xb, turn.yb) : NO_SQ)
+  {
+  }
+
+  // Преобразование в ход в координатах доски
+  move_pos to_move_pos() const
+  {
+    if (beat == NO_SQ)
+      return move_pos(sq_x(from), sq_y(from), sq_x(to), sq_y(to));
+    return move_pos(sq_x(from), sq_y(from), sq_x(to), sq_y(to), sq_x(beat), sq_y(beat));
+  }
+
+  bool operator==(const sq_move& other) const
+  {
+    return from == other.from && to == other.to;
+  }
+
+  bool operator!=(const sq_move& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+// Сведения для отмены хода: побитая фигура и превращение в дамку
+struct undo_info
+{
+  POS_T beaten = 0;       // Побитая фигура в кодировке матрицы доски (0 — взятия не было)
+  bool promoted = false;  // Фигура стала дамкой на этом ходу
+  uint64_t hash = 0;      // Хеш позиции до хода
+};
+
+/**
+ * Позиция на 32 тёмных клетках в виде битовых масок
+ * Клетка (x, y) имеет номер x * 4 + y / 2
+ */
+struct Position
+{
+  uint32_t white = 0;  // Белые фигуры (простые и дамки)
+  uint32_t black = 0;  // Чёрные фигуры (простые и дамки)
+  uint32_t kings = 0;  // Дамки обоих цветов
+  uint64_t hash = 0;   // Хеш Зобриста расстановки фигур, обновляется при каждом ходе
+
+  // Фигуры цвета color (0 — белые, 1 — чёрные)
+  uint32_t pieces(const bool color) const
+  {
+    return color ? black : white;
+  }
+
+  // Свободные клетки
+  uint32_t empty() const
+  {
+    return ~(white | black);
+  }
+
+  // Значение клетки в кодировке матрицы доски (0 — пусто, 1/2 — шашки, 3/4 — дамки)
+  POS_T at(const SQ_T s) const
+  {
+    uint32_t b = sq_bit(s);
+    if (!((white | black) & b))
+      return 0;
+    return POS_T(((black & b) ? 2 : 1) + ((kings & b) ? 2 : 0));
+  }
+
+  // Полный пересчёт хеша по расстановке фигур
+  void update_hash()
+  {
+    hash = 0;
+    for (uint32_t b = white | black; b;)
+    {
+      const SQ_T s = pop_lsb(b);
+      hash ^= ZOBRIST.piece[at(s) - 1][s];
+    }
+  }
+
+  // Выполняет ход (взятие и превращение в дамку учитываются)
+  void apply(const sq_move& turn)
+  {
+    const uint32_t from = sq_bit(turn.from), to = sq_bit(turn.to);
+    hash ^= ZOBRIST.piece[at(turn.from) - 1][turn.from];
+    if (turn.beat != NO_SQ)
+    {
+      hash ^= ZOBRIST.piece[at(turn.beat) - 1][turn.beat];
+      const uint32_t keep = ~sq_bit(turn.beat);
+      white &= keep;
+      black &= keep;
+      kings &= keep;
+    }
+    if (kings & from)
+      kings ^= from | to;
+    else if (to & ((white & from) ? TOP_ROW : BOTTOM_ROW))
+      kings |= to;
+    if (white & from)
+      white ^= from | to;
+    else
+      black ^= from | to;
+    hash ^= ZOBRIST.piece[at(turn.to) - 1][turn.to];
+  }
+
+  // Выполняет ход на месте, запоминая всё необходимое для отмены
+  void make(const sq_move& turn, undo_info& undo)
+  {
+    undo.beaten = (turn.beat != NO_SQ) ? at(turn.beat) : 0;
+    undo.promoted = !(kings & sq_bit(turn.from));
+    undo.hash = hash;
+    apply(turn);
+    undo.promoted = undo.promoted && (kings & sq_bit(turn.to));
+  }
+
+  // Отменяет ход, выполненный make
+  void unmake(const sq_move& turn, const undo_info& undo)
+  {
+    const uint32_t from = sq_bit(turn.from), to = sq_bit(turn.to);
+    if (white & to)
+      white ^= from | to;
+    else
+      black ^= from | to;
+    if (undo.promoted)
+      kings &= ~to;
+    else if (kings & to)
+      kings ^= from | to;
+    if (undo.beaten)
+    {
+      const uint32_t b = sq_bit(turn.beat);
+      if (undo.beaten % 2)
+        white |= b;
+      else
+        black |= b;
+      if (undo.beaten > 2)
+        kings |= b;
+    }
+    hash = undo.hash;
+  }
+
+  // Построение позиции по матрице доски 8x8
+  static Position from_mtx(const std::vector<std::vector<POS_T>>& mtx)
+  {
+    Position pos;
+    for (POS_T i = 0; i < 8; ++i)
+    {
+      for (POS_T j = 0; j < 8; ++j)
+      {
+        if (!mtx[i][j] || (i + j) % 2 == 0)
+          continue;
+        uint32_t b = sq_bit(to_sq(i, j));
+        if (mtx[i][j] % 2)
+          pos.white |= b;
+        else
+          pos.black |= b;
+        if (mtx[i][j] > 2)
+          pos.kings |= b;
+      }
+    }
+    pos.update_hash();
+    return pos;
+  }
+
+  // Обратное преобразование в матрицу доски 8x8
+  std::vector<std::vector<POS_T>> to_mtx() const
+  {
+    std::vector<std::vector<POS_T>> mtx(8, std::vector<POS_T>(8));
+    for (SQ_T s = 0; s < 32; ++s)
+      mtx[sq_x(s)][sq_y(s)] = at(s);
+    return mtx;
+  }
+
+  bool operator==(const Position& other) const
+  {
+    return white == other.white && black == other.black && kings == other.kings;
+  }
+};
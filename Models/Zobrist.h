@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <stdint.h>
+
+/**
+ * Случайные ключи Зобриста для хеширования позиций
+ * Генерируются при компиляции, поэтому одинаковы во всех запусках
+ */
+struct zobrist_keys
+{
+  uint64_t piece[4][32];  // Фигура (1..4 в кодировке матрицы доски минус 1) на клетке
+  uint64_t side;          // Ход чёрных
+  uint64_t bot;           // Оценка ведётся за чёрных
+};
+
+constexpr uint64_t splitmix64(uint64_t& state)
+{
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+constexpr zobrist_keys make_zobrist_keys()
+{
+  zobrist_keys keys{};
+  uint64_t state = 20240501;
+  for (int p = 0; p < 4; ++p)
+  {
+    for (int s = 0; s < 32; ++s)
+      keys.piece[p][s] = splitmix64(state);
+  }
+  keys.side = splitmix64(state);
+  keys.bot = splitmix64(state);
+  return keys;
+}
+
+constexpr zobrist_keys ZOBRIST = make_zobrist_keys();
@@ -0,0 +1,226 @@
+﻿// Анализ набора позиций: каждая позиция ищется на заданную глубину или время, итог — строка JSON
+//
+// Использование:
+//   analyze [--in файл] [--out файл] [--depth N] [--time MS] [--threads N] [--hash MB] [--eval E] [--opt O]
+//           [--tb файл] [--book файл] [--qs 0|1]
+//
+// Во входном файле (по умолчанию stdin) по одной позиции FEN в строке, пустые строки и строки с # пропускаются.
+// Позиции раздаются потокам, у каждого потока свой ИИ с одним потоком поиска и своей таблицей транспозиций,
+// которая переходит от позиции к позиции. Потоки не делят ничего, кроме чтения входа и записи выхода,
+// поэтому скорость растёт с числом ядер. Строки выхода идут в порядке входа:
+//   {"fen":"...","bestmove":"c3-d4","score":1.005,"pv":["c3-d4","f6-e5"],"source":"search","depth":8,...}
+// score — оценка для стороны, которая ходит: отношение её материала к материалу соперника (1 — поровну),
+// от 1e8 и выше — выигрыш, около 0 — проигрыш. Остальные поля — счётчики поиска, как в search_log.jsonl.
+// Позиция с ошибкой или без ходов даёт строку с полем "error".
+// Ход из нескольких равных по оценке зависит от того, какие позиции поток искал до этого, поэтому при другом
+// числе потоков bestmove может смениться на равноценный, а оценка — нет (с точностью до таблицы транспозиций).
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Engine/Logic.h"
+#include "Engine/Notation.h"
+#include "Engine/Pdn.h"
+
+namespace
+{
+  // Строка JSON с экранированием кавычек и обратной косой черты
+  std::string json_string(const std::string& text)
+  {
+    std::string res = "\"";
+    for (const char c : text)
+    {
+      if (c == '"' || c == '\\')
+        res += '\\';
+      if (c >= 0 && c < ' ')
+        continue;
+      res += c;
+    }
+    return res + "\"";
+  }
+
+  // Анализ одной позиции, итог — строка JSON без перевода строки
+  std::string analyze(Logic& logic, const std::string& fen)
+  {
+    bool color = false;
+    Position pos;
+    try
+    {
+      pos = parse_fen(fen, color);
+    }
+    catch (const std::exception& e)
+    {
+      return "{\"fen\":" + json_string(fen) + ",\"error\":" + json_string(e.what()) + "}";
+    }
+    move_list list;
+    gen_moves(pos, color, list);
+    if (list.empty())
+      return "{\"fen\":" + json_string(fen) + ",\"error\":\"no moves\"}";
+
+    search_info last;
+    const auto best = logic.find_best_turns(color, pos.to_mtx(), [&last](const search_info& info) { last = info; });
+    const auto turns = split_turns(pos, best);
+    std::ostringstream out;
+    out << "{\"fen\":" << json_string(fen) << ",\"bestmove\":" << json_string(turns.empty() ? "" : turn_name(turns[0]));
+    // Ход из дебютной книги итераций не даёт, оценки у него нет
+    if (!last.pv.empty())
+    {
+      out.precision(6);
+      out << ",\"score\":" << last.score << ",\"pv\":[";
+      bool first = true;
+      for (const auto& turn : split_turns(pos, last.pv))
+      {
+        out << (first ? "" : ",") << json_string(turn_name(turn));
+        first = false;
+      }
+      out << "]";
+    }
+    out << "," << logic.last_stats().json_fields() << "}";
+    return out.str();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::ios::sync_with_stdio(false);
+  std::string in_path, out_path;
+  int depth = -1, time_ms = 0;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  bot_settings settings;
+  settings.hash_size_mb = 16;
+  settings.no_random = true;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      std::cerr << "usage: analyze [--in file] [--out file] [--depth N] [--time MS] [--threads N] [--hash MB] "
+        "[--eval E] [--opt O] [--tb file] [--book file] [--qs 0|1]" << std::endl;
+      return 2;
+    }
+    const std::string value = argv[++i];
+    if (arg == "--in")
+      in_path = value;
+    else if (arg == "--out")
+      out_path = value;
+    else if (arg == "--depth")
+      depth = std::atoi(value.c_str());
+    else if (arg == "--time")
+      time_ms = std::atoi(value.c_str());
+    else if (arg == "--threads")
+      threads = unsigned(std::max(1, std::atoi(value.c_str())));
+    else if (arg == "--hash")
+      settings.hash_size_mb = unsigned(std::atoi(value.c_str()));
+    else if (arg == "--eval")
+      settings.scoring_mode = value;
+    else if (arg == "--opt")
+      settings.optimization = value;
+    else if (arg == "--tb")
+      settings.tablebase_path = value;
+    else if (arg == "--book")
+      settings.book_path = value;
+    else if (arg == "--qs")
+      settings.quiescence = (value == "1" || value == "true");
+    else
+    {
+      std::cerr << "unknown option " << arg << std::endl;
+      return 2;
+    }
+  }
+  // Без ограничений — глубина 8, с бюджетом времени глубина ограничена только им
+  if (depth < 0)
+    depth = time_ms > 0 ? MAX_PLY - 1 : 8;
+  settings.threads = 1;
+  settings.time_limit_ms = time_ms;
+
+  std::ifstream fin;
+  if (!in_path.empty())
+  {
+    fin.open(in_path);
+    if (!fin)
+    {
+      std::cerr << "can't open " << in_path << std::endl;
+      return 2;
+    }
+  }
+  std::ofstream fout;
+  if (!out_path.empty())
+  {
+    fout.open(out_path, std::ios::trunc);
+    if (!fout)
+    {
+      std::cerr << "can't write " << out_path << std::endl;
+      return 2;
+    }
+  }
+  std::istream& in = in_path.empty() ? std::cin : fin;
+  std::ostream& out = out_path.empty() ? std::cout : fout;
+
+  // Потоки берут строки по очереди, готовые ответы ждут в map, пока не выйдут все более ранние
+  // Опередить запись больше чем на window позиций нельзя, поэтому память не зависит от размера входа
+  const size_t window = size_t(threads) * 64;
+  std::mutex mtx;
+  std::condition_variable written;
+  size_t next_read = 0, next_write = 0;
+  std::map<size_t, std::string> done;
+  const auto start = std::chrono::steady_clock::now();
+
+  auto worker = [&]()
+  {
+    Logic logic(settings);
+    logic.Max_depth = depth;
+    std::string line;
+    while (true)
+    {
+      size_t index;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        written.wait(lock, [&]() { return next_read - next_write < window; });
+        // Пустые строки и комментарии номеров не получают
+        bool found = false;
+        while (!found && std::getline(in, line))
+        {
+          const size_t begin = line.find_first_not_of(" \t\r");
+          const size_t end = line.find_last_not_of(" \t\r");
+          found = begin != std::string::npos && line[begin] != '#';
+          if (found)
+            line = line.substr(begin, end - begin + 1);
+        }
+        if (!found)
+          return;
+        index = next_read++;
+      }
+      std::string res = analyze(logic, line);
+      std::lock_guard<std::mutex> lock(mtx);
+      done.emplace(index, std::move(res));
+      for (auto it = done.begin(); it != done.end() && it->first == next_write; it = done.erase(it))
+      {
+        out << it->second << '\n';
+        ++next_write;
+      }
+      written.notify_all();
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned i = 0; i < threads; ++i)
+    pool.emplace_back(worker);
+  for (auto& th : pool)
+    th.join();
+  out.flush();
+
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cerr << next_write << " positions in " << seconds << " s, " << int(next_write / std::max(seconds, 1e-9))
+    << " positions/s, " << threads << " threads" << std::endl;
+  return out ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+﻿// Построение дебютной книги по партиям ИИ с самим собой или по архиву партий PDN
+//
+// Использование:
+//   bookgen [--games N] [--turns N] [--level L] [--opt O] [--eval E] [--threads N] [--min-count N] [--out файл]
+//           [--pdn файл]
+//
+// Каждая партия играется с начальной позиции на заданном уровне, первые turns ходов записываются в книгу.
+// Случайный выбор среди равных ходов разводит партии, вес хода — сколько раз он был сыгран.
+// Ходы, сыгранные реже min-count раз, в книгу не попадают.
+// С --pdn партии не играются, а читаются из файла (все или первые games, если --games задан): в книгу идут первые
+// turns ходов каждой партии, ходы после ошибки в записи пропускаются.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Engine/Book.h"
+#include "Engine/Logic.h"
+#include "Engine/Notation.h"
+#include "Engine/Pdn.h"
+
+int main(int argc, char* argv[])
+{
+  int games = 200, turns = 8, level = 8, min_count = 1;
+  bool games_given = false;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  bot_settings settings;
+  settings.hash_size_mb = 16;
+  std::string out = "book.bin", pdn_path;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      std::cerr << "usage: bookgen [--games N] [--turns N] [--level L] [--opt O] [--eval E] [--threads N] "
+        "[--min-count N] [--out file] [--pdn file]" << std::endl;
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (arg == "--games")
+    {
+      games = std::atoi(value);
+      games_given = true;
+    }
+    else if (arg == "--turns")
+      turns = std::atoi(value);
+    else if (arg == "--level")
+      level = std::atoi(value);
+    else if (arg == "--opt")
+      settings.optimization = value;
+    else if (arg == "--eval")
+      settings.scoring_mode = value;
+    else if (arg == "--threads")
+      threads = unsigned(std::max(1, std::atoi(value)));
+    else if (arg == "--min-count")
+      min_count = std::atoi(value);
+    else if (arg == "--out")
+      out = value;
+    else if (arg == "--pdn")
+      pdn_path = value;
+    else
+    {
+      std::cerr << "unknown option " << arg << std::endl;
+      return 2;
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::mutex mtx;
+  std::map<std::pair<uint64_t, uint64_t>, uint32_t> counts;
+  std::atomic<int> next_game(0);
+  int read_games = 0;
+
+  // Партии идут параллельно, у каждой свой ИИ и своё начальное значение случайных чисел
+  auto worker = [&]()
+  {
+    std::vector<std::pair<uint64_t, uint64_t>> played;
+    for (int game = next_game++; game < games; game = next_game++)
+    {
+      bot_settings game_settings = settings;
+      game_settings.seed = unsigned(game + 1);
+      Logic logic(game_settings);
+      logic.Max_depth = level;
+      Position pos = start_position();
+      bool color = false;
+      played.clear();
+      for (int turn = 0; turn < turns; ++turn)
+      {
+        move_list list;
+        gen_moves(pos, color, list);
+        if (list.empty())
+          break;
+        const uint64_t key = book_key(pos, color);
+        for (const auto& step : logic.find_best_turns(color, pos.to_mtx()))
+          pos.apply(sq_move(step));
+        color = !color;
+        played.emplace_back(key, book_key(pos, color));
+      }
+      std::lock_guard<std::mutex> lock(mtx);
+      for (const auto& p : played)
+        ++counts[p];
+      if ((game + 1) % 50 == 0)
+        std::cout << game + 1 << " games, " << counts.size() << " moves" << std::endl;
+    }
+  };
+  // Архив читается потоком по одной партии, память не зависит от размера файла
+  auto read_archive = [&]()
+  {
+    std::ifstream fin(pdn_path, std::ios::binary);
+    if (!fin)
+      return false;
+    pdn_reader reader(fin);
+    pdn_game game;
+    int errors = 0;
+    while ((!games_given || read_games < games) && reader.next(game))
+    {
+      ++read_games;
+      errors += !game.error.empty();
+      Position pos = game.start;
+      bool color = game.start_color;
+      for (size_t turn = 0; turn < game.turns.size() && int(turn) < turns; ++turn)
+      {
+        const uint64_t key = book_key(pos, color);
+        for (const auto& step : game.turns[turn])
+          pos.apply(step);
+        color = !color;
+        ++counts[std::make_pair(key, book_key(pos, color))];
+      }
+      if (read_games % 100000 == 0)
+        std::cout << read_games << " games, " << counts.size() << " moves, " << (reader.bytes_read() >> 20) << " MB"
+          << std::endl;
+    }
+    if (errors)
+      std::cerr << errors << " games with errors, moves after an error are skipped" << std::endl;
+    return true;
+  };
+
+  if (!pdn_path.empty())
+  {
+    if (!read_archive())
+    {
+      std::cerr << "can't open " << pdn_path << std::endl;
+      return 1;
+    }
+    games = read_games;
+  }
+  else
+  {
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i)
+      pool.emplace_back(worker);
+    for (auto& th : pool)
+      th.join();
+  }
+
+  // Записи одной позиции идут подряд, по убыванию веса
+  std::vector<book_entry> entries;
+  for (const auto& c : counts)
+  {
+    if (int(c.second) >= min_count)
+      entries.push_back({ c.first.first, c.first.second, c.second, 0 });
+  }
+  std::sort(entries.begin(), entries.end(), [](const book_entry& a, const book_entry& b)
+    {
+      return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+    });
+
+  book_header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+  header.version = BOOK_VERSION;
+  header.count = uint32_t(entries.size());
+  std::ofstream fout(out, std::ios::binary | std::ios::trunc);
+  fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  fout.write(reinterpret_cast<const char*>(entries.data()), std::streamsize(entries.size() * sizeof(book_entry)));
+  if (!fout)
+  {
+    std::cerr << "can't write " << out << std::endl;
+    return 1;
+  }
+  std::cout << "written " << out << ": " << entries.size() << " moves from " << games << " games in "
+    << int(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()) << " s" << std::endl;
+  return 0;
+}
@@ -0,0 +1,298 @@
+﻿// Движок без окна: строковый протокол через stdin/stdout в духе UCI, для запуска из других программ
+//
+// Использование:
+//   engine [--level L] [--eval E] [--opt O] [--hash MB] [--threads N] [--tb файл] [--book файл] [--qs 0|1]
+//          [--norandom 0|1]
+//
+// Команды, по одной в строке:
+//   isready                                      — ответ readyok, когда движок готов принимать команды
+//   newgame                                      — очистить таблицу транспозиций
+//   position startpos|fen FEN [moves ход ...]    — позиция и ходы после неё ("c3-d4", "c3:e5:g3", "c3xg3")
+//   go [depth N] [movetime MS] [nodes N] [infinite]
+//                                                — поиск в фоне; без ограничений — на глубину --level
+//                                                  с infinite bestmove выводится только после stop, go или quit,
+//                                                  даже если поиск дошёл до предельной глубины раньше
+//   stop                                         — прервать поиск, ход — по последней завершённой итерации
+//   quit
+//
+// Ответы:
+//   info depth D score S nodes N nps N time MS pv ход ...   — после каждой итерации поиска
+//   bestmove ход                                           — в конце каждого go (none — ходов нет)
+//   error текст                                            — неверная команда
+// Оценка S — отношение материала стороны, которая ходит, к материалу соперника (1 — поровну), win или loss
+// Таблица транспозиций сохраняется между командами, поэтому поиск в продолжении партии идёт быстрее
+
+#include <algorithm>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Engine/Logic.h"
+#include "Engine/MoveGen.h"
+#include "Engine/Notation.h"
+#include "Engine/Pdn.h"
+
+namespace
+{
+  // Ответы идут и из потока поиска, строки не должны перемешиваться
+  std::mutex out_mtx;
+
+  void send(const std::string& line)
+  {
+    std::lock_guard<std::mutex> lock(out_mtx);
+    std::cout << line << std::endl;
+  }
+
+  std::string score_text(const double score)
+  {
+    if (score >= INF / 2)
+      return "win";
+    if (score < 1e-3)
+      return "loss";
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << score;
+    return out.str();
+  }
+
+  // Первый по порядку ход: если поиск прерван до конца первой итерации, отвечать всё равно нужно
+  std::string any_turn(Position pos, const bool color)
+  {
+    std::string res = "none";
+    std::vector<sq_move> steps;
+    for_each_series(pos, color, [&res](const std::vector<sq_move>& series, const Position&)
+      {
+        res = turn_name(series);
+        return true;
+      }, steps);
+    return res;
+  }
+
+  // Позиция из команды position, при ошибке бросает runtime_error
+  void parse_position(std::istringstream& in, Position& pos, bool& color)
+  {
+    std::string word;
+    in >> word;
+    if (word == "startpos")
+    {
+      pos = start_position();
+      color = false;
+    }
+    else if (word == "fen")
+    {
+      std::string fen;
+      in >> fen;
+      pos = parse_fen(fen, color);
+    }
+    else
+      throw std::runtime_error("position: expected startpos or fen");
+    if (!(in >> word))
+      return;
+    if (word != "moves")
+      throw std::runtime_error("position: expected moves, got " + word);
+    std::vector<SQ_T> squares;
+    std::vector<sq_move> steps;
+    while (in >> word)
+    {
+      if (!parse_turn_squares(word.data(), word.size(), squares) || !match_turn(pos, color, squares, steps))
+        throw std::runtime_error("position: illegal move " + word + " in " + to_fen(pos, color));
+      for (const auto& step : steps)
+        pos.apply(step);
+      color = !color;
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::ios::sync_with_stdio(false);
+  int level = 8;
+  bot_settings settings;
+  settings.hash_size_mb = 64;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      std::cerr << "usage: engine [--level L] [--eval E] [--opt O] [--hash MB] [--threads N] [--tb file] "
+        "[--book file] [--qs 0|1] [--norandom 0|1]" << std::endl;
+      return 2;
+    }
+    const std::string value = argv[++i];
+    if (arg == "--level")
+      level = std::atoi(value.c_str());
+    else if (arg == "--eval")
+      settings.scoring_mode = value;
+    else if (arg == "--opt")
+      settings.optimization = value;
+    else if (arg == "--hash")
+      settings.hash_size_mb = unsigned(std::atoi(value.c_str()));
+    else if (arg == "--threads")
+      settings.threads = unsigned(std::atoi(value.c_str()));
+    else if (arg == "--tb")
+      settings.tablebase_path = value;
+    else if (arg == "--book")
+      settings.book_path = value;
+    else if (arg == "--qs")
+      settings.quiescence = (value == "1" || value == "true");
+    else if (arg == "--norandom")
+      settings.no_random = (value == "1" || value == "true");
+    else
+    {
+      std::cerr << "unknown option " << arg << std::endl;
+      return 2;
+    }
+  }
+
+  // Результат текущего поиска, его забирает on_done в потоке поиска
+  // Ответ поиска go infinite ждёт в held до stop, следующего go или quit
+  std::mutex search_mtx;
+  std::shared_future<std::vector<move_pos>> pending;
+  std::string held;
+  bool pending_infinite = false;
+
+  // Один ИИ на весь сеанс: таблица транспозиций и история ходов переживают команды
+  Logic logic(settings);
+  Position pos = start_position();
+  bool color = false;
+
+  // Останавливает поиск и выводит отложенный ответ go infinite
+  auto stop_search = [&]()
+  {
+    logic.cancel_search();
+    std::lock_guard<std::mutex> lock(search_mtx);
+    if (!held.empty())
+      send(held);
+    held.clear();
+  };
+
+  std::string line;
+  bool quit = false;
+  while (!quit && std::getline(std::cin, line))
+  {
+    std::istringstream in(line);
+    std::string command;
+    if (!(in >> command))
+      continue;
+    try
+    {
+      if (command == "quit")
+        quit = true;
+      else if (command == "isready")
+        send("readyok");
+      else if (command == "newgame")
+      {
+        logic.new_game();
+        pos = start_position();
+        color = false;
+      }
+      else if (command == "position")
+      {
+        Position next;
+        bool next_color = false;
+        parse_position(in, next, next_color);
+        pos = next;
+        color = next_color;
+      }
+      else if (command == "go")
+      {
+        search_limits limits;
+        limits.iterate = true;
+        int depth = -1;
+        bool infinite = false;
+        std::string word;
+        long long value = 0;
+        while (in >> word)
+        {
+          if (word == "infinite")
+          {
+            infinite = true;
+            continue;
+          }
+          if (!(in >> value) || value < 0)
+            throw std::runtime_error("go: expected a number after " + word);
+          if (word == "depth")
+            depth = int(value);
+          else if (word == "movetime")
+            limits.time_ms = int(value);
+          else if (word == "nodes")
+            limits.nodes = size_t(value);
+          else
+            throw std::runtime_error("go: unknown limit " + word);
+        }
+        const bool limited = infinite || limits.time_ms > 0 || limits.nodes > 0;
+        // Прошлый поиск сначала отвечает своим ходом
+        stop_search();
+        logic.limits = limits;
+        logic.Max_depth = depth >= 0 ? std::min(depth, MAX_PLY - 1) : limited ? MAX_PLY - 1 : level;
+        const Position root = pos;
+        const bool root_color = color;
+        std::lock_guard<std::mutex> lock(search_mtx);
+        pending_infinite = infinite;
+        pending = logic.find_best_turns_async(color, pos.to_mtx(),
+          [root](const search_info& info)
+          {
+            std::ostringstream out;
+            out << "info depth " << info.depth << " score " << score_text(info.score) << " nodes " << info.nodes
+              << " nps " << size_t(info.nps()) << " time " << size_t(info.time_ms) << " pv";
+            for (const auto& turn : split_turns(root, info.pv))
+              out << ' ' << turn_name(turn);
+            send(out.str());
+          },
+          [&search_mtx, &pending, &held, root, root_color, infinite]()
+          {
+            std::shared_future<std::vector<move_pos>> result;
+            {
+              std::lock_guard<std::mutex> lock(search_mtx);
+              result = pending;
+            }
+            std::string answer;
+            try
+            {
+              const auto turns = split_turns(root, result.get());
+              answer = "bestmove " + (turns.empty() ? any_turn(root, root_color) : turn_name(turns[0]));
+            }
+            catch (const std::exception& e)
+            {
+              answer = std::string("error ") + e.what();
+            }
+            // Бесконечный поиск отвечает только по команде, даже если дошёл до предельной глубины сам
+            if (infinite)
+            {
+              std::lock_guard<std::mutex> lock(search_mtx);
+              held = answer;
+            }
+            else
+              send(answer);
+          });
+      }
+      else if (command == "stop")
+        stop_search();
+      else
+        send("error unknown command " + command);
+    }
+    catch (const std::exception& e)
+    {
+      send(std::string("error ") + e.what());
+    }
+  }
+
+  // Конец ввода не прерывает начатый поиск с ограничениями: его ход тоже нужен; go infinite останавливается
+  std::shared_future<std::vector<move_pos>> last;
+  bool last_infinite = false;
+  {
+    std::lock_guard<std::mutex> lock(search_mtx);
+    last = pending;
+    last_infinite = pending_infinite;
+  }
+  if (!quit && !last_infinite && last.valid())
+    last.wait();
+  stop_search();
+  return 0;
+}
@@ -0,0 +1,142 @@
+﻿// Замер оценки позиций: по одной (Eval::score) и блоками (eval_batch) на всех доступных наборах команд
+//
+// Использование:
+//   evalbench [--positions N] [--seed S]
+//
+// Позиции берутся из случайных партий с начальной позиции, все варианты оценивают одни и те же позиции
+// и обязаны дать одинаковый результат.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Engine/Eval.h"
+#include "Engine/EvalBatch.h"
+#include "Engine/MoveGen.h"
+#include "Engine/Notation.h"
+
+namespace
+{
+  struct positions
+  {
+    std::vector<uint32_t> white, black, kings;
+  };
+
+  // Позиции случайных партий: ход выбирается равновероятно, серия взятий доигрывается до конца
+  positions collect(const size_t count, const unsigned seed)
+  {
+    positions res;
+    std::default_random_engine rand_eng(seed);
+    while (res.white.size() < count)
+    {
+      Position pos = start_position();
+      bool color = false;
+      for (int turn = 0; turn < 200 && res.white.size() < count; ++turn)
+      {
+        move_list list;
+        gen_moves(pos, color, list);
+        if (list.empty())
+          break;
+        sq_move step = list[int(rand_eng() % unsigned(list.size))];
+        pos.apply(step);
+        while (step.beat != NO_SQ)
+        {
+          move_list more;
+          gen_beats_from(pos, step.to, more);
+          if (more.empty())
+            break;
+          step = more[int(rand_eng() % unsigned(more.size))];
+          pos.apply(step);
+        }
+        color = !color;
+        res.white.push_back(pos.white);
+        res.black.push_back(pos.black);
+        res.kings.push_back(pos.kings);
+      }
+    }
+    return res;
+  }
+
+  template <class F>
+  double time_ns(F&& f, const size_t count)
+  {
+    // Лучшее из трёх повторов
+    double best = 1e300;
+    for (int rep = 0; rep < 3; ++rep)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      f();
+      best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best / count;
+  }
+
+  template <class Eval>
+  bool bench(const char* name, const positions& p)
+  {
+    const size_t n = p.white.size();
+    std::vector<double> expected(n), got(n);
+    const double scalar_ns = time_ns([&]()
+      {
+        for (size_t i = 0; i < n; ++i)
+        {
+          Position pos;
+          pos.white = p.white[i];
+          pos.black = p.black[i];
+          pos.kings = p.kings[i];
+          expected[i] = Eval::score(pos, i % 2 == 0);
+        }
+      }, n);
+    std::cout << name << ": score " << scalar_ns << " ns";
+
+    bool ok = true;
+    for (const SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSE4, SimdLevel::AVX2 })
+    {
+      if (level > simd_level())
+        break;
+      // Чётные позиции оцениваются за белых, нечётные — за чёрных, как в цикле выше
+      const double ns = time_ns([&]()
+        {
+          std::vector<double> other(n);
+          eval_batch<Eval>(p.white.data(), p.black.data(), p.kings.data(), n, true, got.data(), level);
+          eval_batch<Eval>(p.white.data(), p.black.data(), p.kings.data(), n, false, other.data(), level);
+          for (size_t i = 1; i < n; i += 2)
+            got[i] = other[i];
+        }, n * 2);
+      const bool same = std::memcmp(expected.data(), got.data(), n * sizeof(double)) == 0;
+      ok = ok && same;
+      std::cout << ", batch " << simd_name(level) << " " << ns << " ns" << (same ? "" : " MISMATCH");
+    }
+    std::cout << " per position" << std::endl;
+    return ok;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  size_t count = 1000000;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--positions" && i + 1 < argc)
+      count = size_t(std::atoll(argv[++i]));
+    else if (arg == "--seed" && i + 1 < argc)
+      seed = unsigned(std::atoi(argv[++i]));
+    else
+    {
+      std::cerr << "usage: evalbench [--positions N] [--seed S]" << std::endl;
+      return 2;
+    }
+  }
+
+  const positions p = collect(count, seed);
+  std::cout << p.white.size() << " positions, best instruction set " << simd_name(simd_level()) << std::endl;
+  const bool ok = bench<NumberOnly>("NumberOnly", p) && bench<NumberAndPotential>("NumberAndPotential", p);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,282 @@
+﻿// Perft: подсчёт числа позиций на заданной глубине для проверки и замера генератора ходов
+//
+// Использование:
+//   perft [глубина] [--fen FEN] [--divide] [--diff]
+//     без --fen        прогон набора тестовых позиций
+//     --divide         число позиций отдельно для каждого хода из корня
+//     --diff           сверка генератора с эталонным Logic::find_turns в каждом узле дерева
+//
+// Ход — вся серия взятий целиком, как в игре: после взятия та же фигура бьёт дальше, пока может
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Engine/Logic.h"
+#include "Engine/MoveGen.h"
+#include "Engine/Notation.h"
+
+namespace
+{
+  // Тестовая позиция с глубиной прогона по умолчанию
+  struct perft_position
+  {
+    const char* name;
+    const char* fen;
+    int depth;
+  };
+
+  const perft_position SUITE[] = {
+    { "start", "W:Wa1,c1,e1,g1,b2,d2,f2,h2,a3,c3,e3,g3:Bb8,d8,f8,h8,a7,c7,e7,g7,b6,d6,f6,h6", 9 },
+    { "kings", "W:WKa1,c3,e3,g3:Bb6,d6,f6,Kh8", 6 },
+    { "men capture chains", "W:Wc1,e3,g3,a3:Bb4,d4,f4,d6,f6,b6,h6", 8 },
+    { "promotion in series", "W:Wc5,e5:Bb6,d6,f6,b4,g7,e7", 8 },
+    { "king capture chains", "B:WKa1,c3,e5,f2,b6,g5:Bd8,Kh8,a7", 6 },
+    { "endgame", "W:WKa1,Kh2,c3:Bf8,Kd8,h6,Kb8", 6 },
+  };
+
+  // Набор ходов для сравнения: откуда, куда, кого бьём
+  typedef std::vector<std::tuple<int, int, int>> turn_set;
+
+  turn_set to_set(const move_list& list)
+  {
+    turn_set res;
+    for (const auto& turn : list)
+      res.emplace_back(turn.from, turn.to, turn.beat);
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  turn_set to_set(const std::vector<move_pos>& turns)
+  {
+    turn_set res;
+    for (const auto& turn : turns)
+    {
+      const sq_move m(turn);
+      res.emplace_back(m.from, m.to, m.beat);
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  std::string set_name(const turn_set& turns)
+  {
+    std::string res;
+    for (const auto& turn : turns)
+    {
+      res += " " + sq_name(SQ_T(std::get<0>(turn))) + (std::get<2>(turn) != NO_SQ ? ":" : "-") +
+        sq_name(SQ_T(std::get<1>(turn)));
+    }
+    return res.empty() ? " (нет ходов)" : res;
+  }
+
+  // Эталон для сверки: матричный генератор без таблицы транспозиций
+  bot_settings reference_settings()
+  {
+    bot_settings settings;
+    settings.optimization = "O0";
+    settings.hash_size_mb = 0;
+    return settings;
+  }
+
+  class Perft
+  {
+  public:
+    explicit Perft(const bool diff) : diff(diff), ref(reference_settings())
+    {
+    }
+
+    /**
+     * Число позиций на глубине depth от текущей
+     * s — клетка фигуры, продолжающей серию взятий (NO_SQ — начало хода)
+     */
+    uint64_t count(Position& pos, const bool color, const int depth, const SQ_T s = NO_SQ)
+    {
+      if (depth == 0)
+        return 1;
+      move_list list;
+      if (s == NO_SQ)
+        gen_moves(pos, color, list);
+      else
+        gen_beats_from(pos, s, list);
+      if (diff)
+        check(pos, color, s, list);
+
+      // Серия закончилась, ход переходит к сопернику
+      if (s != NO_SQ && list.empty())
+        return count(pos, !color, depth - 1);
+      if (depth == 1 && !list.have_beats && !diff)
+        return uint64_t(list.size);
+
+      uint64_t nodes = 0;
+      for (const auto& turn : list)
+      {
+        undo_info undo;
+        pos.make(turn, undo);
+        nodes += (turn.beat != NO_SQ) ? count(pos, color, depth, turn.to) : count(pos, !color, depth - 1);
+        pos.unmake(turn, undo);
+      }
+      return nodes;
+    }
+
+    // Число позиций для каждого хода из корня, ходы печатаются целиком вместе с сериями взятий
+    uint64_t divide(Position& pos, const bool color, const int depth)
+    {
+      std::vector<sq_move> series;
+      return divide_rec(pos, color, depth, NO_SQ, series);
+    }
+
+    // Число найденных расхождений с эталоном
+    uint64_t mismatches = 0;
+
+  private:
+    uint64_t divide_rec(Position& pos, const bool color, const int depth, const SQ_T s, std::vector<sq_move>& series)
+    {
+      move_list list;
+      if (s == NO_SQ)
+        gen_moves(pos, color, list);
+      else
+        gen_beats_from(pos, s, list);
+      if (diff)
+        check(pos, color, s, list);
+      if (s != NO_SQ && list.empty())
+      {
+        const uint64_t nodes = count(pos, !color, depth - 1);
+        std::cout << turn_name(series) << " " << nodes << std::endl;
+        return nodes;
+      }
+
+      uint64_t nodes = 0;
+      for (const auto& turn : list)
+      {
+        undo_info undo;
+        pos.make(turn, undo);
+        series.push_back(turn);
+        if (turn.beat != NO_SQ)
+        {
+          nodes += divide_rec(pos, color, depth, turn.to, series);
+        }
+        else
+        {
+          const uint64_t sub = count(pos, !color, depth - 1);
+          std::cout << turn_name(series) << " " << sub << std::endl;
+          nodes += sub;
+        }
+        series.pop_back();
+        pos.unmake(turn, undo);
+      }
+      return nodes;
+    }
+
+    // Сверка списка ходов с эталонным генератором по матрице доски
+    void check(const Position& pos, const bool color, const SQ_T s, const move_list& list)
+    {
+      const auto mtx = pos.to_mtx();
+      turn_set expected;
+      bool expected_beats;
+      if (s == NO_SQ)
+      {
+        ref.find_turns(color, mtx);
+        expected = to_set(ref.turns);
+        expected_beats = ref.have_beats;
+      }
+      else
+      {
+        // В игре серия продолжается, только если у фигуры есть взятия
+        ref.find_turns(sq_x(s), sq_y(s), mtx);
+        if (ref.have_beats)
+          expected = to_set(ref.turns);
+        expected_beats = ref.have_beats;
+      }
+      const turn_set got = to_set(list);
+      if (got == expected && list.have_beats == expected_beats)
+        return;
+      if (++mismatches <= 10)
+      {
+        std::cout << "mismatch in " << to_fen(pos, color);
+        if (s != NO_SQ)
+          std::cout << " (серия с " << sq_name(s) << ")";
+        std::cout << "\n  movegen:  " << set_name(got) << "\n  reference:" << set_name(expected) << std::endl;
+      }
+    }
+
+    const bool diff;
+    Logic ref;
+  };
+
+  // Прогон одной позиции с выводом скорости
+  uint64_t run(Perft& perft, const std::string& fen, const int depth, const bool divide)
+  {
+    bool color;
+    Position pos = parse_fen(fen, color);
+    std::cout << to_fen(pos, color) << std::endl;
+    uint64_t total = 0;
+    for (int d = (divide ? depth : 1); d <= depth; ++d)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      const uint64_t nodes = divide ? perft.divide(pos, color, d) : perft.count(pos, color, d);
+      const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << "depth " << d << " nodes " << nodes << " time " << int(sec * 1000) << " ms";
+      if (sec > 0)
+        std::cout << " " << uint64_t(nodes / sec) << " nodes/sec";
+      std::cout << std::endl;
+      total += nodes;
+    }
+    return total;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int depth = 0;
+  std::string fen;
+  bool divide = false, diff = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--fen" && i + 1 < argc)
+      fen = argv[++i];
+    else if (arg == "--divide")
+      divide = true;
+    else if (arg == "--diff")
+      diff = true;
+    else if (!arg.empty() && std::isdigit((unsigned char)arg[0]))
+      depth = std::atoi(arg.c_str());
+    else
+    {
+      std::cerr << "usage: perft [depth] [--fen FEN] [--divide] [--diff]" << std::endl;
+      return 2;
+    }
+  }
+
+  Perft perft(diff);
+  try
+  {
+    if (!fen.empty())
+    {
+      run(perft, fen, depth > 0 ? depth : 6, divide);
+    }
+    else
+    {
+      for (const auto& test : SUITE)
+      {
+        std::cout << "== " << test.name << std::endl;
+        run(perft, test.fen, depth > 0 ? depth : test.depth, divide);
+      }
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 2;
+  }
+  if (diff)
+    std::cout << "mismatches: " << perft.mismatches << std::endl;
+  return perft.mismatches ? 1 : 0;
+}
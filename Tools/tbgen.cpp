@@ -0,0 +1,353 @@
+﻿// Построение эндшпильных таблиц ретроградным анализом
+//
+// Использование:
+//   tbgen [--pieces N] [--threads N] [--out файл]
+//
+// Решаются все позиции, где у обеих сторон вместе не больше N фигур (по умолчанию 4).
+// Срезы решаются от меньшего числа фигур к большему, при равном числе — от меньшего числа простых:
+// взятие уменьшает число фигур, превращение — число простых, поэтому все такие ходы ведут в уже решённые срезы.
+// Внутри пары срезов (материал и он же с точки зрения соперника) ходы вперёд строятся для каждой позиции
+// один раз: ходы в решённые срезы сразу дают значения, ходы внутри пары только считаются. Дальше значения
+// расходятся назад по обратным ходам в порядке числа ходов до конца: позиция перед проигрышем выиграна,
+// у позиции перед выигрышем уменьшается счётчик ходов внутри пары, и когда он дошёл до нуля, а ничьей
+// среди решённых ходов нет, позиция проиграна. Поэтому выигрыш — за наименьшее число ходов, проигрыш —
+// за наибольшее, и каждая позиция обходится постоянное число раз. Нерешённые позиции — ничьи.
+// В файле один байт на позицию: 4 фигуры — 7 МБ, 5 — 150 МБ, 6 — 2.7 ГБ; пока пара срезов решается,
+// на каждую её позицию нужно ещё 4 байта и очередь решённых
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Engine/MoveGen.h"
+#include "Engine/Tablebase.h"
+
+namespace
+{
+  class Generator
+  {
+  public:
+    Generator(const int max_pieces, const unsigned threads) : max_pieces(max_pieces), threads(threads)
+    {
+      const int n = TB_MAX_PIECES + 1;
+      data.resize(size_t(n * n * n * n));
+    }
+
+    // Решает все срезы по порядку
+    void solve_all()
+    {
+      std::vector<tb_material> order;
+      for_each_material([&](const tb_material& m) { order.push_back(m); });
+      std::stable_sort(order.begin(), order.end(), [](const tb_material& a, const tb_material& b)
+        {
+          return std::make_pair(a.total(), a.wm + a.bm) < std::make_pair(b.total(), b.wm + b.bm);
+        });
+      for (const auto& m : order)
+      {
+        if (!slice(m).empty())
+          continue;
+        if (m == m.flipped())
+          solve_group({ m });
+        else
+          solve_group({ m, m.flipped() });
+      }
+    }
+
+    // Записывает таблицы в файл: заголовок со смещениями, затем срезы подряд
+    bool write(const std::string& path)
+    {
+      tb_header header;
+      std::memset(&header, 0, sizeof(header));
+      std::memcpy(header.magic, TB_MAGIC, sizeof(TB_MAGIC));
+      header.version = TB_VERSION;
+      header.max_pieces = uint32_t(max_pieces);
+      uint64_t offset = sizeof(header);
+      for_each_material([&](const tb_material& m)
+        {
+          header.offsets[m.wm][m.wk][m.bm][m.bk] = offset;
+          offset += slice(m).size();
+        });
+
+      std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+      fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      for_each_material([&](const tb_material& m)
+        {
+          const auto& s = slice(m);
+          fout.write(reinterpret_cast<const char*>(s.data()), std::streamsize(s.size()));
+        });
+      return bool(fout);
+    }
+
+  private:
+    // Все срезы, где у каждой стороны есть хотя бы одна фигура, в порядке записи в файл
+    template <class F>
+    void for_each_material(F&& f) const
+    {
+      for (int wm = 0; wm <= max_pieces; ++wm)
+        for (int wk = 0; wm + wk <= max_pieces; ++wk)
+          for (int bm = 0; wm + wk + bm <= max_pieces; ++bm)
+            for (int bk = 0; wm + wk + bm + bk <= max_pieces; ++bk)
+              if (wm + wk > 0 && bm + bk > 0)
+                f(tb_material{ wm, wk, bm, bk });
+    }
+
+    std::vector<uint8_t>& slice(const tb_material& m)
+    {
+      const int n = TB_MAX_PIECES + 1;
+      return data[size_t(((m.wm * n + m.wk) * n + m.bm) * n + m.bk)];
+    }
+
+    const std::vector<uint8_t>& slice(const tb_material& m) const
+    {
+      const int n = TB_MAX_PIECES + 1;
+      return data[size_t(((m.wm * n + m.wk) * n + m.bm) * n + m.bk)];
+    }
+
+    // Флаги позиции, пока решается её пара срезов
+    enum : uint8_t
+    {
+      VALID = 1,     // номер соответствует позиции
+      SOLVED = 2,    // значение окончательное
+      HAS_DRAW = 4   // есть ход в решённую ничью
+    };
+
+    // Срез пары и то, что известно о его позициях
+    struct slice_state
+    {
+      tb_material m;
+      size_t other = 0;            // Номер отражённого среза в паре
+      std::vector<uint8_t> flags;
+      std::vector<uint8_t> open;   // Ходы внутри пары, после которых соперник ещё не выиграл
+      std::vector<uint8_t> win;    // Самый быстрый найденный выигрыш, 0 — выигрыша нет
+      std::vector<uint8_t> loss;   // Самый долгий проигрыш среди решённых ходов
+    };
+
+    // Значения после ходов в решённые срезы и число ходов внутри пары, позиции делятся между потоками
+    void scan(slice_state& st) const
+    {
+      const tb_material inside = st.m.flipped();
+      const size_t size = st.flags.size();
+      const size_t parts = std::max<size_t>(1, std::min<size_t>(threads, size / 4096 + 1));
+      auto work = [&](const size_t part)
+      {
+        Position pos;
+        for (size_t i = part; i < size; i += parts)
+        {
+          if (!tb_unindex(st.m, i, pos))
+            continue;
+          uint8_t flags = VALID;
+          int open = 0, win = 0, loss = 0;
+          for_each_turn(pos, false, [&](const Position& after)
+            {
+              const Position p = flip_colors(after);
+              const tb_material m = material_of(p);
+              if (m == inside)
+              {
+                ++open;
+                return;
+              }
+              const tb_entry e = (m.wm + m.wk == 0) ? tb_entry{ TbResult::LOSS, 0 } : tb_decode(slice(m)[tb_index(p, m)]);
+              if (e.result == TbResult::LOSS)
+                win = win ? std::min(win, e.distance + 1) : e.distance + 1;
+              else if (e.result == TbResult::WIN)
+                loss = std::max(loss, e.distance + 1);
+              else
+                flags |= HAS_DRAW;
+            });
+          st.flags[i] = flags;
+          st.open[i] = uint8_t(open);
+          st.win[i] = uint8_t(win);
+          st.loss[i] = uint8_t(loss);
+        }
+      };
+      std::vector<std::thread> pool;
+      for (size_t part = 1; part < parts; ++part)
+        pool.emplace_back(work, part);
+      work(0);
+      for (auto& th : pool)
+        th.join();
+    }
+
+    /**
+     * Позиции, из которых чёрные ходом без взятия и превращения попадают в pos (ход белых)
+     * Позиция перед ходом повёрнута к ходу белых, как в таблице. Если у чёрных там было взятие,
+     * тихий ход был запрещён, и такой позиции нет
+     */
+    template <class F>
+    static void for_each_unmove(const Position& pos, F&& f)
+    {
+      const uint32_t empty = pos.empty();
+      for (uint32_t b = pos.black; b;)
+      {
+        const SQ_T to = pop_lsb(b);
+        const bool king = (pos.kings & sq_bit(to)) != 0;
+        // Простые чёрных ходят вниз, поэтому пришли сверху
+        for (int dir = 0; dir < (king ? 4 : 2); ++dir)
+        {
+          for (SQ_T from = neighbour(to, dir); from != NO_SQ && (empty & sq_bit(from)); from = neighbour(from, dir))
+          {
+            Position prev = pos;
+            prev.black ^= sq_bit(to) | sq_bit(from);
+            if (king)
+              prev.kings ^= sq_bit(to) | sq_bit(from);
+            if (!has_beats(prev, true))
+              f(flip_colors(prev));
+            if (!king)
+              break;
+          }
+        }
+      }
+    }
+
+    // Решает срез вместе с его отражением: ходы без взятий и превращений переводят из одного в другой
+    void solve_group(const std::vector<tb_material>& group)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      std::vector<slice_state> states(group.size());
+      for (size_t g = 0; g < group.size(); ++g)
+      {
+        slice_state& st = states[g];
+        st.m = group[g];
+        st.other = group.size() - 1 - g;
+        const size_t size = size_t(tb_slice_size(st.m));
+        slice(st.m).assign(size, 0);
+        st.flags.assign(size, 0);
+        st.open.assign(size, 0);
+        st.win.assign(size, 0);
+        st.loss.assign(size, 0);
+        scan(st);
+      }
+
+      // Очередь по числу ходов до конца: позиция решается, когда до неё дошла очередь
+      // Выигрыш может позже найтись быстрее, тогда позиция встаёт в очередь ещё раз, старая запись пропускается
+      // Запись — номер среза в паре и номер позиции: в срезах 8 фигур номера не помещаются в 32 бита
+      const int max_distance = 255;
+      std::vector<std::vector<std::pair<uint32_t, uint64_t>>> queue(max_distance + 1);
+      auto push = [&queue](const int distance, const size_t g, const uint64_t i)
+      {
+        queue[size_t(distance)].emplace_back(uint32_t(g), i);
+      };
+      for (size_t g = 0; g < group.size(); ++g)
+      {
+        const slice_state& st = states[g];
+        for (size_t i = 0; i < st.flags.size(); ++i)
+        {
+          if (!(st.flags[i] & VALID))
+            continue;
+          if (st.win[i])
+            push(st.win[i], g, i);
+          else if (!st.open[i] && !(st.flags[i] & HAS_DRAW))
+            push(st.loss[i], g, i);
+        }
+      }
+
+      std::vector<size_t> wins(group.size()), losses(group.size());
+      for (int d = 0; d <= max_distance; ++d)
+      {
+        // Размер перечитывается: при d = max_distance позиции встают в ту же очередь
+        for (size_t k = 0; k < queue[size_t(d)].size(); ++k)
+        {
+          const size_t g = queue[size_t(d)][k].first;
+          const uint64_t i = queue[size_t(d)][k].second;
+          slice_state& st = states[g];
+          if (st.flags[i] & SOLVED)
+            continue;
+          // Позиция с выигрышем в очередь на проигрыш не встаёт, а выигрыш быстрее уже решён раньше
+          const bool win = st.win[i] != 0;
+          st.flags[i] |= SOLVED;
+          slice(st.m)[i] = tb_encode({ win ? TbResult::WIN : TbResult::LOSS, d });
+          ++(win ? wins : losses)[g];
+
+          Position pos;
+          tb_unindex(st.m, i, pos);
+          slice_state& prev = states[st.other];
+          const int next = std::min(d + 1, max_distance);
+          for_each_unmove(pos, [&](const Position& p)
+            {
+              const uint64_t j = tb_index(p, prev.m);
+              if (prev.flags[j] & SOLVED)
+                return;
+              if (!win)
+              {
+                if (!prev.win[j] || prev.win[j] > next)
+                {
+                  prev.win[j] = uint8_t(next);
+                  push(next, st.other, j);
+                }
+                return;
+              }
+              prev.loss[j] = uint8_t(std::max<int>(prev.loss[j], next));
+              if (--prev.open[j] == 0 && !prev.win[j] && !(prev.flags[j] & HAS_DRAW))
+                push(prev.loss[j], st.other, j);
+            });
+        }
+        std::vector<std::pair<uint32_t, uint64_t>>().swap(queue[size_t(d)]);
+      }
+
+      for (size_t g = 0; g < group.size(); ++g)
+      {
+        const slice_state& st = states[g];
+        const size_t valid = size_t(std::count_if(st.flags.begin(), st.flags.end(),
+          [](const uint8_t f) { return (f & VALID) != 0; }));
+        const tb_material& m = group[g];
+        std::cout << m.wm << "m" << m.wk << "k vs " << m.bm << "m" << m.bk << "k: " << st.flags.size() << " indexes, "
+          << wins[g] << " wins, " << losses[g] << " losses, " << valid - wins[g] - losses[g] << " draws";
+        if (g + 1 == group.size())
+          std::cout << ", " << int(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()) << " ms";
+        std::cout << std::endl;
+      }
+    }
+
+    const int max_pieces;
+    const unsigned threads;
+
+    // Значения позиций по срезам, индекс — материал
+    std::vector<std::vector<uint8_t>> data;
+  };
+}
+
+int main(int argc, char* argv[])
+{
+  int pieces = 4;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string out = "endgame.tb";
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--pieces" && i + 1 < argc)
+      pieces = std::atoi(argv[++i]);
+    else if (arg == "--threads" && i + 1 < argc)
+      threads = unsigned(std::max(1, std::atoi(argv[++i])));
+    else if (arg == "--out" && i + 1 < argc)
+      out = argv[++i];
+    else
+    {
+      std::cerr << "usage: tbgen [--pieces N] [--threads N] [--out file]" << std::endl;
+      return 2;
+    }
+  }
+  if (pieces < 2 || pieces > TB_MAX_PIECES)
+  {
+    std::cerr << "pieces must be from 2 to " << TB_MAX_PIECES << std::endl;
+    return 2;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  Generator gen(pieces, threads);
+  gen.solve_all();
+  if (!gen.write(out))
+  {
+    std::cerr << "can't write " << out << std::endl;
+    return 1;
+  }
+  std::cout << "written " << out << " in "
+    << int(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()) << " s" << std::endl;
+  return 0;
+}
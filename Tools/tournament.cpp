@@ -0,0 +1,460 @@
+﻿// Турнир двух настроек ИИ без окна: партии идут параллельно, по одной на ядро
+//
+// Использование:
+//   tournament --a "level=5,opt=O1" --b "level=5,opt=O2" [--games N] [--concurrency N]
+//              [--opening-turns N] [--max-turns N] [--elo0 E] [--elo1 E] [--alpha A] [--beta B] [--seed S]
+//              [--log файл] [--pdn файл]
+//
+// Ключи настроек ИИ: level (BotLevel), eval (BotScoringType), opt (Optimization), time (BotTimeMS),
+// hash (HashSizeMB), threads (Threads), tb (TablebasePath), book (BookPath), norandom (NoRandom: 0 или 1),
+// qs (Quiescence: 0 или 1)
+//
+// Каждый дебют играется дважды со сменой цветов. Турнир останавливается досрочно,
+// когда SPRT принимает одну из гипотез: elo0 (B не сильнее) или elo1 (B сильнее A на elo1)
+// С --log счётчики поиска каждого хода пишутся в файл строками JSON, с --pdn партии записываются в файл PDN
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "Engine/Logic.h"
+#include "Engine/MoveGen.h"
+#include "Engine/Notation.h"
+#include "Engine/Pdn.h"
+
+namespace
+{
+  // Настройки одного участника
+  struct engine_config
+  {
+    bot_settings settings;
+    int level = 5;
+    std::string text;
+  };
+
+  // Значение из списка допустимых, как у выбора в settings.json
+  std::string get_choice(const std::string& key, const std::string& value, std::initializer_list<const char*> choices)
+  {
+    std::string list;
+    for (const char* choice : choices)
+    {
+      if (value == choice)
+        return value;
+      list += (list.empty() ? "" : ", ") + std::string(choice);
+    }
+    throw std::runtime_error("engine option " + key + " must be one of " + list);
+  }
+
+  engine_config parse_engine(const std::string& text)
+  {
+    engine_config cfg;
+    cfg.text = text;
+    cfg.settings.threads = 1;
+    cfg.settings.hash_size_mb = 16;
+    size_t i = 0;
+    while (i < text.size())
+    {
+      size_t j = text.find(',', i);
+      if (j == std::string::npos)
+        j = text.size();
+      const std::string item = text.substr(i, j - i);
+      i = j + 1;
+      const size_t eq = item.find('=');
+      if (eq == std::string::npos)
+        throw std::runtime_error("bad engine option: " + item);
+      const std::string key = item.substr(0, eq), value = item.substr(eq + 1);
+      if (key == "level")
+        cfg.level = std::atoi(value.c_str());
+      else if (key == "eval")
+        cfg.settings.scoring_mode = get_choice(key, value, { "NumberOnly", "NumberAndPotential" });
+      else if (key == "opt")
+        cfg.settings.optimization = get_choice(key, value, { "O0", "O1", "O2" });
+      else if (key == "time")
+        cfg.settings.time_limit_ms = std::atoi(value.c_str());
+      else if (key == "hash")
+        cfg.settings.hash_size_mb = unsigned(std::atoi(value.c_str()));
+      else if (key == "threads")
+        cfg.settings.threads = unsigned(std::atoi(value.c_str()));
+      else if (key == "tb")
+        cfg.settings.tablebase_path = value;
+      else if (key == "book")
+        cfg.settings.book_path = value;
+      else if (key == "norandom")
+        cfg.settings.no_random = (value == "1" || value == "true");
+      else if (key == "qs")
+        cfg.settings.quiescence = (value == "1" || value == "true");
+      else
+        throw std::runtime_error("unknown engine option: " + key);
+    }
+    return cfg;
+  }
+
+  // Дебютная позиция: расстановка и чья очередь хода
+  struct opening
+  {
+    Position pos;
+    bool color;
+  };
+
+  // Все позиции после turns ходов из начальной (серия взятий — один ход)
+  void collect_openings(Position& pos, const bool color, const int turns, const SQ_T s,
+    std::set<std::tuple<uint32_t, uint32_t, uint32_t, bool>>& seen, std::vector<opening>& res)
+  {
+    if (turns == 0)
+    {
+      // Сбалансированные дебюты: поровну фигур у обеих сторон
+      if (popcount(pos.white) == popcount(pos.black) &&
+        seen.insert(std::make_tuple(pos.white, pos.black, pos.kings, color)).second)
+        res.push_back({ pos, color });
+      return;
+    }
+    move_list list;
+    if (s == NO_SQ)
+      gen_moves(pos, color, list);
+    else
+      gen_beats_from(pos, s, list);
+    if (s != NO_SQ && list.empty())
+    {
+      collect_openings(pos, !color, turns - 1, NO_SQ, seen, res);
+      return;
+    }
+    for (const auto& turn : list)
+    {
+      undo_info undo;
+      pos.make(turn, undo);
+      if (turn.beat != NO_SQ)
+        collect_openings(pos, color, turns, turn.to, seen, res);
+      else
+        collect_openings(pos, !color, turns - 1, NO_SQ, seen, res);
+      pos.unmake(turn, undo);
+    }
+  }
+
+  // Итог партии для участника A: 1 — победа, 0.5 — ничья, 0 — поражение
+  struct game_result
+  {
+    double score_a;
+    int turns;
+  };
+
+  // Суммарное время и число ходов участника
+  struct time_stat
+  {
+    double ms = 0;
+    long long moves = 0;
+  };
+
+  /**
+   * Одна партия без окна по правилам Game::play
+   * Проигрывает сторона без ходов, после max_turns ходов — ничья
+   * Если задан log, в него добавляется строка JSON со счётчиками поиска на каждый ход
+   * Если задан record, в него записываются ходы партии от дебютной позиции и итог
+   */
+  game_result play_game(const opening& start, const bool a_is_white, const engine_config& a, const engine_config& b,
+    const int max_turns, const int opening_turns, time_stat& time_a, time_stat& time_b, std::string* log,
+    pdn_game* record)
+  {
+    if (record)
+    {
+      record->start = start.pos;
+      record->start_color = start.color;
+    }
+    Logic logic_a(a.settings), logic_b(b.settings);
+    logic_a.Max_depth = a.level;
+    logic_b.Max_depth = b.level;
+    Position pos = start.pos;
+    bool color = start.color;
+    for (int turn_num = opening_turns; turn_num < max_turns; ++turn_num)
+    {
+      move_list list;
+      gen_moves(pos, color, list);
+      if (list.empty())
+      {
+        const bool a_lost = (color == !a_is_white);
+        if (record)
+          record->result = color ? "2-0" : "0-2";
+        return { a_lost ? 0.0 : 1.0, turn_num };
+      }
+      const bool a_to_move = (color == !a_is_white);
+      Logic& logic = a_to_move ? logic_a : logic_b;
+      const auto begin = std::chrono::steady_clock::now();
+      const auto turns = logic.find_best_turns(color, pos.to_mtx());
+      time_stat& stat = a_to_move ? time_a : time_b;
+      stat.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+      ++stat.moves;
+      if (turns.empty())
+        throw std::runtime_error("engine returned no move in " + to_fen(pos, color));
+      if (log)
+      {
+        *log += std::string("{\"engine\":\"") + (a_to_move ? "A" : "B") + "\",\"fen\":\"" + to_fen(pos, color) +
+          "\",\"pieces\":" + std::to_string(popcount(pos.white | pos.black)) + ",\"level\":" +
+          std::to_string(logic.Max_depth) + "," + logic.last_stats().json_fields() + "}\n";
+      }
+      if (record)
+        record->turns.emplace_back();
+      for (const auto& turn : turns)
+      {
+        pos.apply(sq_move(turn));
+        if (record)
+          record->turns.back().push_back(sq_move(turn));
+      }
+      color = !color;
+    }
+    if (record)
+      record->result = "1-1";
+    return { 0.5, max_turns };
+  }
+
+  // Счёт турнира с точки зрения участника B против A
+  struct tally
+  {
+    long long wins = 0, draws = 0, losses = 0;
+
+    long long games() const
+    {
+      return wins + draws + losses;
+    }
+
+    double mean() const
+    {
+      return games() ? (wins + 0.5 * draws) / games() : 0.5;
+    }
+
+    // Дисперсия очков за партию
+    double variance() const
+    {
+      const double m = mean(), n = double(games());
+      if (!n)
+        return 0;
+      return (wins * (1 - m) * (1 - m) + draws * (0.5 - m) * (0.5 - m) + losses * m * m) / n;
+    }
+  };
+
+  // Разница в Эло по средней доле очков
+  double elo_from_score(double score)
+  {
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400 * std::log10(1 / score - 1);
+  }
+
+  double score_from_elo(const double elo)
+  {
+    return 1 / (1 + std::pow(10, -elo / 400));
+  }
+
+  // Логарифм отношения правдоподобия гипотез elo1 и elo0 (нормальное приближение, как в fishtest)
+  double sprt_llr(const tally& t, const double elo0, const double elo1)
+  {
+    const double var = t.variance();
+    if (t.games() < 2 || var <= 0)
+      return 0;
+    const double s0 = score_from_elo(elo0), s1 = score_from_elo(elo1);
+    return t.games() * (s1 - s0) * (2 * t.mean() - s0 - s1) / (2 * var);
+  }
+
+  void print_status(const tally& t, const double llr, const double lower, const double upper,
+    const time_stat& time_a, const time_stat& time_b)
+  {
+    const double m = t.mean();
+    const double err = t.games() ? 1.96 * std::sqrt(t.variance() / t.games()) : 0;
+    const double elo = elo_from_score(m);
+    const double elo_err = (elo_from_score(std::min(m + err, 1.0)) - elo_from_score(std::max(m - err, 0.0))) / 2;
+    std::cout << std::fixed << std::setprecision(1) << "games " << t.games() << "  B vs A: +" << t.wins << " =" << t.draws
+      << " -" << t.losses << "  elo " << elo << " +- " << elo_err << std::setprecision(2) << "  LLR " << llr << " ["
+      << lower << ", " << upper << "]" << std::setprecision(1) << "  ms/move A " << (time_a.moves ? time_a.ms / time_a.moves : 0)
+      << " B " << (time_b.moves ? time_b.ms / time_b.moves : 0) << std::endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::string a_text = "level=5", b_text = "level=5";
+  long long max_games = 1000;
+  unsigned concurrency = std::max(1u, std::thread::hardware_concurrency());
+  int opening_turns = 3, max_turns = 120;
+  double elo0 = 0, elo1 = 10, alpha = 0.05, beta = 0.05;
+  unsigned seed = 1;
+  std::string log_path, pdn_path;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      std::cerr << "missing value for " << arg << std::endl;
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (arg == "--a")
+      a_text = value;
+    else if (arg == "--b")
+      b_text = value;
+    else if (arg == "--games")
+      max_games = std::atoll(value);
+    else if (arg == "--concurrency")
+      concurrency = std::max(1, std::atoi(value));
+    else if (arg == "--opening-turns")
+      opening_turns = std::atoi(value);
+    else if (arg == "--max-turns")
+      max_turns = std::atoi(value);
+    else if (arg == "--elo0")
+      elo0 = std::atof(value);
+    else if (arg == "--elo1")
+      elo1 = std::atof(value);
+    else if (arg == "--alpha")
+      alpha = std::atof(value);
+    else if (arg == "--beta")
+      beta = std::atof(value);
+    else if (arg == "--seed")
+      seed = unsigned(std::atoi(value));
+    else if (arg == "--log")
+      log_path = value;
+    else if (arg == "--pdn")
+      pdn_path = value;
+    else
+    {
+      std::cerr << "unknown option " << arg << std::endl;
+      return 2;
+    }
+  }
+
+  engine_config a, b;
+  try
+  {
+    a = parse_engine(a_text);
+    b = parse_engine(b_text);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 2;
+  }
+
+  // Дебюты перемешиваются один раз, каждый играется парой партий со сменой цветов
+  std::vector<opening> openings;
+  {
+    Position pos = start_position();
+    std::set<std::tuple<uint32_t, uint32_t, uint32_t, bool>> seen;
+    collect_openings(pos, false, opening_turns, NO_SQ, seen, openings);
+    std::shuffle(openings.begin(), openings.end(), std::default_random_engine(seed));
+  }
+  if (openings.empty())
+  {
+    std::cerr << "no balanced openings after " << opening_turns << " turns" << std::endl;
+    return 2;
+  }
+
+  const double lower = std::log(beta / (1 - alpha)), upper = std::log((1 - beta) / alpha);
+  std::cout << "A: " << a.text << "\nB: " << b.text << "\n" << openings.size() << " openings, " << concurrency
+    << " games in parallel, SPRT elo0 " << elo0 << " elo1 " << elo1 << std::endl;
+
+  std::ofstream log_out;
+  if (!log_path.empty())
+  {
+    log_out.open(log_path, std::ios::trunc);
+    if (!log_out)
+    {
+      std::cerr << "can't write " << log_path << std::endl;
+      return 2;
+    }
+  }
+  std::ofstream pdn_out;
+  if (!pdn_path.empty())
+  {
+    pdn_out.open(pdn_path, std::ios::trunc);
+    if (!pdn_out)
+    {
+      std::cerr << "can't write " << pdn_path << std::endl;
+      return 2;
+    }
+  }
+
+  std::mutex mtx;
+  tally total;
+  time_stat time_a, time_b;
+  double llr = 0;
+  std::atomic<long long> next_game(0);
+  std::atomic<bool> stop(false);
+
+  auto worker = [&]()
+  {
+    while (!stop)
+    {
+      const long long game = next_game++;
+      if (game >= max_games)
+        break;
+      const opening& start = openings[size_t(game / 2) % openings.size()];
+      const bool a_is_white = (game % 2 == 0);
+      time_stat ta, tb;
+      game_result res;
+      std::string log;
+      pdn_game record;
+      try
+      {
+        res = play_game(start, a_is_white, a, b, max_turns, opening_turns, ta, tb, log_out.is_open() ? &log : nullptr,
+          pdn_out.is_open() ? &record : nullptr);
+      }
+      catch (const std::exception& e)
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::cerr << e.what() << std::endl;
+        stop = true;
+        break;
+      }
+
+      std::lock_guard<std::mutex> lock(mtx);
+      log_out << log;
+      if (pdn_out.is_open())
+      {
+        record.set_tag("Event", "tournament");
+        record.set_tag("Round", std::to_string(game + 1));
+        record.set_tag("White", a_is_white ? "A: " + a.text : "B: " + b.text);
+        record.set_tag("Black", a_is_white ? "B: " + b.text : "A: " + a.text);
+        write_pdn(pdn_out, record);
+      }
+      if (res.score_a == 0)
+        ++total.wins;
+      else if (res.score_a == 1)
+        ++total.losses;
+      else
+        ++total.draws;
+      time_a.ms += ta.ms;
+      time_a.moves += ta.moves;
+      time_b.ms += tb.ms;
+      time_b.moves += tb.moves;
+      llr = sprt_llr(total, elo0, elo1);
+      if (total.games() % 10 == 0)
+        print_status(total, llr, lower, upper, time_a, time_b);
+      if (llr <= lower || llr >= upper)
+        stop = true;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < concurrency; ++i)
+    threads.emplace_back(worker);
+  for (auto& th : threads)
+    th.join();
+
+  print_status(total, llr, lower, upper, time_a, time_b);
+  if (llr >= upper)
+    std::cout << "SPRT: H1 accepted, B is stronger by at least " << elo1 << " elo" << std::endl;
+  else if (llr <= lower)
+    std::cout << "SPRT: H0 accepted, B is not stronger than elo " << elo0 << std::endl;
+  else
+    std::cout << "SPRT: inconclusive" << std::endl;
+  return 0;
+}